@@ -0,0 +1,183 @@
+// Parser throughput benchmark.
+//
+// Compares the table-driven VtParser with the hand-written three-state
+// if/else chain Terminal::processOutput used before it, on synthetic corpora
+// (and optionally a recorded session), then measures the full
+// Terminal::processOutput path including grid writes.
+//
+// Usage: termbench [recording.rec]
+
+#include "../src/SessionRecording.h"
+#include "../src/Terminal.h"
+#include "../src/VtParser.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Counts parser events so the work can't be optimized away
+struct CountingPerformer {
+  uint64_t printed = 0;
+  uint64_t executed = 0;
+  uint64_t sequences = 0;
+
+  void vtPrint(uint32_t c) { printed += c; }
+  void vtPrintAscii(const char *text, size_t length) {
+    printed += length + (unsigned char)text[length - 1];
+  }
+  void vtExecute(uint8_t c) { executed++; }
+  void vtEscDispatch(const VtParser &parser, uint8_t finalByte) {
+    sequences++;
+  }
+  void vtCsiDispatch(const VtParser &parser, uint8_t finalByte) {
+    sequences += parser.getParamCount() + 1;
+  }
+  void vtOscDispatch(std::string_view data) { sequences++; }
+  void vtDcsHook(const VtParser &parser, uint8_t finalByte) {}
+  void vtDcsPut(uint8_t c) {}
+  void vtDcsUnhook() {}
+};
+
+// The pre-VtParser state machine from Terminal::processOutput, with grid
+// writes replaced by the same counters
+struct LegacyParser {
+  enum class ParserState { Normal, Esc, Csi };
+  ParserState parserState = ParserState::Normal;
+  std::string csiParams;
+
+  void feed(std::string_view output, CountingPerformer &performer) {
+    for (char c : output) {
+      if (parserState == ParserState::Normal) {
+        if (c == 27) {
+          parserState = ParserState::Esc;
+        } else if (c == '\n' || c == '\r' || c == '\b' || c == 7) {
+          performer.executed++;
+        } else if (c >= 32 || c == 9) {
+          performer.printed += (unsigned char)c;
+        }
+      } else if (parserState == ParserState::Esc) {
+        if (c == '[') {
+          parserState = ParserState::Csi;
+          csiParams = "";
+        } else {
+          parserState = ParserState::Normal;
+        }
+      } else if (parserState == ParserState::Csi) {
+        if (c >= '0' && c <= '9') {
+          csiParams += c;
+        } else if (c == ';') {
+          csiParams += c;
+        } else if (c >= 0x40 && c <= 0x7E) {
+          performer.sequences += csiParams.size() + 1;
+          parserState = ParserState::Normal;
+        }
+      }
+    }
+  }
+};
+
+static std::string makePlainCorpus(size_t size) {
+  std::string corpus;
+  int line = 0;
+  while (corpus.size() < size) {
+    corpus += "src/Terminal.cpp:" + std::to_string(line++) +
+              ": note: the quick brown fox jumps over the lazy dog\r\n";
+  }
+  return corpus;
+}
+
+static std::string makeColorCorpus(size_t size) {
+  std::string corpus;
+  int line = 0;
+  while (corpus.size() < size) {
+    corpus += "\x1b[1;34mdir" + std::to_string(line++) +
+              "\x1b[0m  \x1b[32mbuild.sh\x1b[0m  \x1b[38;5;208mnotes.md\x1b[0m"
+              "  \x1b[01;31marchive.tar.gz\x1b[0m\r\n";
+    if (line % 50 == 0)
+      corpus += "\x1b]0;user@host: ~/src\x07\x1b[2K\x1b[1G";
+  }
+  return corpus;
+}
+
+template <typename Fn> static double measure(size_t bytes, int passes, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < passes; i++)
+    fn();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return (double)bytes * passes / 1e6 / seconds;
+}
+
+// Mixed-script text; 4093-byte chunks cut multibyte sequences at the seams
+static std::string makeUtf8Corpus(size_t size) {
+  std::string corpus;
+  int line = 0;
+  while (corpus.size() < size) {
+    corpus += std::to_string(line++) +
+              " caf\xc3\xa9 \xce\xba\xce\xb1\xce\xbb\xce\xb7\xce\xbc"
+              "\xce\xad\xcf\x81\xce\xb1 \xe6\x97\xa5\xe6\x9c\xac\xe8"
+              "\xaa\x9e \xe2\x9c\x93 \xf0\x9f\x98\x80 plain ascii tail\r\n";
+  }
+  return corpus;
+}
+
+static void runCorpus(const char *name, const std::vector<std::string_view> &chunks) {
+  size_t bytes = 0;
+  for (auto chunk : chunks)
+    bytes += chunk.size();
+  int passes = (int)(200e6 / (bytes + 1)) + 1;
+
+  CountingPerformer legacyCount, tableCount;
+  double legacy = measure(bytes, passes, [&]() {
+    LegacyParser parser;
+    for (auto chunk : chunks)
+      parser.feed(chunk, legacyCount);
+  });
+  double table = measure(bytes, passes, [&]() {
+    VtParser parser;
+    for (auto chunk : chunks)
+      parser.feed(chunk, tableCount);
+  });
+
+  // End to end, including grid writes. Fewer passes: history keeps growing.
+  int terminalPasses = passes > 5 ? 5 : passes;
+  double terminal = measure(bytes, terminalPasses, [&]() {
+    Terminal term(80 * 11.0f, 24 * 20.0f);
+    for (auto chunk : chunks)
+      term.processOutput(chunk);
+  });
+
+  printf("%-12s %8.2f MB  legacy %8.1f MB/s  table %8.1f MB/s  "
+         "Terminal %8.1f MB/s\n",
+         name, bytes / 1e6, legacy, table, terminal);
+}
+
+static std::vector<std::string_view> split(const std::string &corpus,
+                                           size_t chunkSize) {
+  std::vector<std::string_view> chunks;
+  for (size_t i = 0; i < corpus.size(); i += chunkSize)
+    chunks.push_back(std::string_view(corpus).substr(i, chunkSize));
+  return chunks;
+}
+
+int main(int argc, char **argv) {
+  std::string plain = makePlainCorpus(8 << 20);
+  std::string color = makeColorCorpus(8 << 20);
+  std::string utf8 = makeUtf8Corpus(8 << 20);
+
+  runCorpus("plain", split(plain, 65536));
+  runCorpus("color", split(color, 65536));
+  runCorpus("utf8", split(utf8, 4093));
+
+  if (argc > 1) {
+    SessionReplay replay;
+    if (!replay.load(argv[1]))
+      return 1;
+    std::vector<std::string_view> chunks;
+    for (const auto &chunk : replay.getChunks())
+      chunks.push_back(chunk.data);
+    runCorpus("recording", chunks);
+  }
+  return 0;
+}
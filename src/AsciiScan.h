@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Byte-class scans for the parser's ground-state fast paths. Both return the
+// length of the leading run of bytes in the class, i.e. the index of the
+// first byte outside it.
+//
+// Printable ASCII is 0x20-0x7E. Text additionally includes 0x80-0xFF, so a
+// text run is everything up to the next C0 control or DEL.
+//
+// Read as signed, a byte is < 0x20 for C0 and for 0x80-0xFF; flipping the
+// top bit first turns that into an unsigned compare that lets 0x80-0xFF
+// through.
+template <bool AllowHigh>
+inline size_t scanByteRun(const unsigned char *data, size_t size) {
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i flip32 = _mm256_set1_epi8(AllowHigh ? (char)0x80 : 0);
+  const __m256i space32 = _mm256_set1_epi8(AllowHigh ? (char)0xA0 : 0x20);
+  const __m256i del32 = _mm256_set1_epi8(0x7F);
+  for (; i + 32 <= size; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i below = _mm256_cmpgt_epi8(space32, _mm256_xor_si256(v, flip32));
+    __m256i bad = _mm256_or_si256(below, _mm256_cmpeq_epi8(v, del32));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(bad);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+
+#if defined(__SSE2__)
+  const __m128i flip = _mm_set1_epi8(AllowHigh ? (char)0x80 : 0);
+  const __m128i space = _mm_set1_epi8(AllowHigh ? (char)0xA0 : 0x20);
+  const __m128i del = _mm_set1_epi8(0x7F);
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i below = _mm_cmplt_epi8(_mm_xor_si128(v, flip), space);
+    __m128i bad = _mm_or_si128(below, _mm_cmpeq_epi8(v, del));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(bad);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  const uint8x16_t del = vdupq_n_u8(0x7F);
+  const uint8x16_t high = vdupq_n_u8(AllowHigh ? 0x00 : 0x7F);
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t v = vld1q_u8(data + i);
+    uint8x16_t bad = vorrq_u8(vcltq_u8(v, space), vceqq_u8(v, del));
+    if (!AllowHigh)
+      bad = vorrq_u8(bad, vcgtq_u8(v, high));
+    // Narrow each byte of the mask to a nibble to get a 64-bit bitmap
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bad), 4)), 0);
+    if (mask)
+      return i + (__builtin_ctzll(mask) >> 2);
+  }
+#endif
+
+  // Scalar tail (and fallback for other targets)
+  for (; i < size; i++) {
+    unsigned char c = data[i];
+    if (c < 0x20 || c == 0x7F || (!AllowHigh && c > 0x7F))
+      return i;
+  }
+  return size;
+}
+
+// Run of printable ASCII (0x20-0x7E)
+inline size_t scanPrintableAscii(const unsigned char *data, size_t size) {
+  return scanByteRun<false>(data, size);
+}
+
+// Run of text bytes: printable ASCII or 0x80-0xFF (UTF-8 sequences)
+inline size_t scanText(const unsigned char *data, size_t size) {
+  return scanByteRun<true>(data, size);
+}
@@ -76,6 +76,8 @@ void Background::createShader() {
     )";
 
   shader = new Shader(vs, fs, true);
+  shader->use();
+  shader->set(shader->uniform<int>("bgTexture"), 0);
 }
 
 bool Background::load(const std::string &path) {
@@ -159,22 +161,34 @@ bool Background::load(const std::string &path) {
   return true;
 }
 
-void Background::render(float deltaTime) {
+bool Background::update(float deltaTime) {
+  if (frames.size() <= 1)
+    return false;
+
+  currentTime += deltaTime * 1000.0f; // to ms
+  if (currentTime >= frames[currentFrameIndex].delay) {
+    currentTime -= frames[currentFrameIndex].delay;
+    currentFrameIndex = (currentFrameIndex + 1) % frames.size();
+    return true;
+  }
+  return false;
+}
+
+float Background::timeUntilNextFrame() const {
+  if (frames.size() <= 1)
+    return -1.0f;
+
+  float remaining = (frames[currentFrameIndex].delay - currentTime) / 1000.0f;
+  return remaining > 0.0f ? remaining : 0.0f;
+}
+
+void Background::render() {
   if (frames.empty())
     return;
   if (!shader)
     return;
 
-  if (frames.size() > 1) {
-    currentTime += deltaTime * 1000.0f; // to ms
-    if (currentTime >= frames[currentFrameIndex].delay) {
-      currentTime -= frames[currentFrameIndex].delay;
-      currentFrameIndex = (currentFrameIndex + 1) % frames.size();
-    }
-  }
-
   shader->use();
-  shader->setInt("bgTexture", 0);
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, frames[currentFrameIndex].textureID);
 
@@ -16,7 +16,12 @@ public:
   ~Background();
 
   bool load(const std::string &path);
-  void render(float deltaTime);
+
+  // Advances the animation, returns true if the visible frame changed
+  bool update(float deltaTime);
+  // Seconds until the next frame is due, or -1 for static backgrounds
+  float timeUntilNextFrame() const;
+  void render();
 
 private:
   float currentTime;
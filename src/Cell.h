@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// One grid cell, packed into 8 bytes: a 21-bit codepoint (all of Unicode),
+// 11 bits of attribute flags and two 16-bit color indices. Colors are
+// indices rather than RGB so a cell never carries floats; Terminal resolves
+// them to RGB when the frontend draws (see Terminal::resolveColor).
+struct Cell {
+  uint32_t codepoint : 21;
+  uint32_t attributes : 11;
+  uint16_t fg;
+  uint16_t bg;
+
+  bool operator==(const Cell &other) const {
+    return codepoint == other.codepoint && attributes == other.attributes &&
+           fg == other.fg && bg == other.bg;
+  }
+  bool operator!=(const Cell &other) const { return !(*this == other); }
+};
+static_assert(sizeof(Cell) == 8, "Cell must stay 8 bytes");
+
+// Cell::attributes flags. Bit n-1 is set by SGR n (and cleared by SGR
+// 20+n), which keeps handleSgr a shift.
+enum CellAttribute : uint16_t {
+  ATTR_BOLD = 1 << 0,
+  ATTR_DIM = 1 << 1,
+  ATTR_ITALIC = 1 << 2,
+  ATTR_UNDERLINE = 1 << 3,
+  ATTR_BLINK = 1 << 4,
+  ATTR_RAPID_BLINK = 1 << 5,
+  ATTR_INVERSE = 1 << 6,
+  ATTR_INVISIBLE = 1 << 7,
+  ATTR_STRIKETHROUGH = 1 << 8,
+};
+
+// Cell::fg / Cell::bg values:
+//   0-255   the xterm 256-color palette (0-15 ANSI, cube, grayscale ramp)
+//   256+    the special colors below
+//   TRUECOLOR_BASE+  entries of the terminal's 24-bit color table
+enum CellColor : uint16_t {
+  COLOR_DEFAULT_FG = 256,
+  COLOR_DEFAULT_BG = 257,
+  COLOR_INPUT = 258, // Text typed by the user (gold)
+  TRUECOLOR_BASE = 259,
+};
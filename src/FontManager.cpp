@@ -1,10 +1,15 @@
 #include "FontManager.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
 
 FontManager::FontManager() {
   if (FT_Init_FreeType(&ft)) {
     std::cout << "ERROR::FREETYPE: Could not init FreeType Library"
               << std::endl;
   }
+  glyphs.push_back(Character{0, {0, 0}, {0, 0}, 0, 0, 0, 0, 0});
+  pages[0].reset(new uint32_t[256]());
 }
 
 FontManager::~FontManager() {
@@ -24,80 +29,141 @@ bool FontManager::loadFont(std::string fontPath, unsigned int fontSize) {
   // Disable byte-alignment restriction
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-  // Initialize Atlas Texture
-  glGenTextures(1, &atlasTextureID);
-  glBindTexture(GL_TEXTURE_2D, atlasTextureID);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlasWidth, atlasHeight, 0, GL_RED,
-               GL_UNSIGNED_BYTE, NULL);
+  // Square slots a line tall hold any glyph of this size, CJK included
+  int lineHeight = (int)((face->size->metrics.height + 63) >> 6);
+  slotSize = std::min(std::max(lineHeight + 1, 8), 256);
+  slotsPerRow = atlasWidth / slotSize;
+  staging.assign((size_t)slotSize * slotSize, 0);
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Atlas memory budget, in whole layers
+  size_t budgetMB = 16;
+  if (const char *setting = getenv("TERMINALGL_ATLAS_MB"))
+    budgetMB = (size_t)std::max(atoi(setting), 1);
+  size_t layerBytes = (size_t)atlasWidth * atlasHeight;
+  maxLayers = (int)std::min<size_t>(
+      std::max<size_t>(budgetMB * 1024 * 1024 / layerBytes, 1), 256);
 
-  // Reserve space for white pixel at (0,0) for solid rects
-  // We can upload it now: max value
+  // Record 0 is the empty glyph
+  glyphs.assign(1, Character{0, {0, 0}, {0, 0}, 0, 0, 0, 0, 0});
+  lastUse.assign(1, 0);
+  codepoints.assign(1, 0);
+  addLayers(1);
+
+  // Reserve space for white pixel at (0,0) for solid rects: slot 0 of
+  // layer 0 is never handed out
+  freeSlots.erase(std::find(freeSlots.begin(), freeSlots.end(), 0));
   unsigned char white = 255;
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RED, GL_UNSIGNED_BYTE,
-                  &white);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, atlasTextureID);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 1, 1, 1, GL_RED,
+                  GL_UNSIGNED_BYTE, &white);
 
-  // Move cursor to avoid overwriting white pixel
-  atlasX = 2;
-  atlasY = 0;
-  atlasRowHeight = 0;
+  // Preload printable ASCII
+  for (unsigned int c = 0x20; c < 0x7f; c++)
+    getCharacter(c);
 
   return true;
 }
 
-Character FontManager::getCharacter(unsigned int codepoint) {
-  if (Characters.find(codepoint) != Characters.end()) {
-    return Characters[codepoint];
+const Character &FontManager::loadCharacter(unsigned int codepoint) {
+  uint32_t &entry = tableEntry(codepoint);
+  if (entry == 0) {
+    int64_t index = loadGlyph(codepoint);
+    if (index < 0)
+      return glyphs[0]; // No slot this time; try again next lookup
+    entry = (uint32_t)index + 1;
   }
+  lastUse[entry - 1] = frame;
+  return glyphs[entry - 1];
+}
 
-  if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER)) {
-    std::cout << "ERROR::FREETYTPE: Failed to load Glyph for codepoint: "
-              << codepoint << std::endl;
-    // Return empty with atlasID to prevent crashes
-    return Character{atlasTextureID, {0, 0}, {0, 0}, 0, 0, 0, 0, 0};
-  }
+static size_t astralHash(uint32_t codepoint) {
+  return (size_t)(((uint64_t)codepoint * 0x9e3779b97f4a7c15ull) >> 32);
+}
 
-  // Calculate glyph dimensions
-  int w = face->glyph->bitmap.width;
-  int h = face->glyph->bitmap.rows;
+uint32_t &FontManager::tableEntry(unsigned int codepoint) {
+  if (codepoint < 0x10000) {
+    std::unique_ptr<uint32_t[]> &page = pages[codepoint >> 8];
+    if (!page)
+      page.reset(new uint32_t[256]());
+    return page[codepoint & 0xff];
+  }
 
-  // Simple packing: Move to next line if full
-  // Add 1px padding
-  if (atlasX + w + 1 >= atlasWidth) {
-    atlasX = 0;
-    atlasY += atlasRowHeight + 1; // Move down
-    atlasRowHeight = 0;
+  // Existing keys first: growing would move the entry callers hold
+  if (!astral.empty()) {
+    size_t mask = astral.size() - 1;
+    for (size_t i = astralHash(codepoint) & mask; astral[i].codepoint != 0;
+         i = (i + 1) & mask) {
+      if (astral[i].codepoint == codepoint)
+        return astral[i].entry;
+    }
   }
 
-  // Update row height
-  if (h > atlasRowHeight) {
-    atlasRowHeight = h;
+  if ((astralCount + 1) * 2 > astral.size())
+    growAstral();
+  size_t mask = astral.size() - 1;
+  size_t i = astralHash(codepoint) & mask;
+  while (astral[i].codepoint != 0)
+    i = (i + 1) & mask;
+  astral[i].codepoint = codepoint;
+  astralCount++;
+  return astral[i].entry;
+}
+
+void FontManager::growAstral() {
+  std::vector<AstralSlot> old(std::max<size_t>(64, astral.size() * 2),
+                              AstralSlot{0, 0});
+  old.swap(astral);
+  size_t mask = astral.size() - 1;
+  for (const AstralSlot &slot : old) {
+    if (slot.codepoint == 0)
+      continue;
+    size_t i = astralHash(slot.codepoint) & mask;
+    while (astral[i].codepoint != 0)
+      i = (i + 1) & mask;
+    astral[i] = slot;
   }
+}
 
-  // Check if atlas is full (naive)
-  if (atlasY + h >= atlasHeight) {
-    std::cout << "ERROR: Texture Atlas Full!" << std::endl;
-    // Ideally we would flush or make new atlas, but for now just fail
-    // gracefully
-    return Character{atlasTextureID, {0, 0}, {0, 0}, 0, 0, 0, 0, 0};
+int64_t FontManager::loadGlyph(unsigned int codepoint) {
+  // Failures are cached as the empty glyph, so they are reported once
+  if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER)) {
+    std::cout << "ERROR::FREETYTPE: Failed to load Glyph for codepoint: "
+              << codepoint << std::endl;
+    return 0;
   }
 
-  // Upload to Atlas
-  glBindTexture(GL_TEXTURE_2D, atlasTextureID);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, atlasX, atlasY, w, h, GL_RED,
-                  GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
+  int64_t slot = allocateSlot();
+  if (slot < 0)
+    return -1;
+  int layer = (int)(slot / ((int64_t)slotsPerRow * slotsPerRow));
+  int cell = (int)(slot % ((int64_t)slotsPerRow * slotsPerRow));
+  int x = (cell % slotsPerRow) * slotSize;
+  int y = (cell / slotsPerRow) * slotSize;
+
+  // Glyphs beyond a slot (rare oversized ones) are cropped; keep one
+  // blank pixel of padding so filtering never picks up a neighbour
+  const FT_Bitmap &bitmap = face->glyph->bitmap;
+  int w = std::min((int)bitmap.width, slotSize - 1);
+  int h = std::min((int)bitmap.rows, slotSize - 1);
+
+  // Upload the whole slot so nothing of an evicted glyph is left behind
+  std::fill(staging.begin(), staging.end(), 0);
+  for (int row = 0; row < h; row++)
+    std::copy(bitmap.buffer + (size_t)row * bitmap.pitch,
+              bitmap.buffer + (size_t)row * bitmap.pitch + w,
+              staging.begin() + (size_t)row * slotSize);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, atlasTextureID);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, slotSize, slotSize, 1,
+                  GL_RED, GL_UNSIGNED_BYTE, staging.data());
 
   // Calculate UVs
-  float tx = (float)atlasX / (float)atlasWidth;
-  float ty = (float)atlasY / (float)atlasHeight;
+  float tx = (float)x / (float)atlasWidth;
+  float ty = (float)y / (float)atlasHeight;
   float tw = (float)w / (float)atlasWidth;
   float th = (float)h / (float)atlasHeight;
 
-  Character character = {
+  uint32_t index = (uint32_t)slot + 1;
+  glyphs[index] = Character{
       atlasTextureID,
       glm::ivec2(w, h),
       glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
@@ -105,11 +171,107 @@ Character FontManager::getCharacter(unsigned int codepoint) {
       tx,
       ty,
       tw,
-      th};
+      th,
+      (unsigned int)layer};
+  lastUse[index] = frame;
+  codepoints[index] = codepoint;
+  return index;
+}
+
+int64_t FontManager::allocateSlot() {
+  if (freeSlots.empty()) {
+    if (layers < maxLayers) {
+      // Double, up to the budget
+      addLayers(std::min(layers, maxLayers - layers));
+    } else if (!evict()) {
+      // Everything resident was drawn this frame: go over budget rather
+      // than drop a glyph on screen
+      if (layers >= 256)
+        return -1;
+      if (!overBudgetReported) {
+        std::cout << "Glyph atlas: frame needs more than the budget, adding "
+                     "layers"
+                  << std::endl;
+        overBudgetReported = true;
+      }
+      addLayers(1);
+    }
+  }
+  if (freeSlots.empty())
+    return -1;
+  uint32_t slot = freeSlots.back();
+  freeSlots.pop_back();
+  return slot;
+}
+
+void FontManager::addLayers(int count) {
+  int newLayers = layers + count;
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, atlasWidth, atlasHeight,
+               newLayers, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  if (layers > 0) {
+    // Copy the old layers through a read framebuffer (no
+    // glCopyImageSubData before GL 4.3)
+    GLint previous = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+    unsigned int fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    for (int layer = 0; layer < layers; layer++) {
+      glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                atlasTextureID, 0, layer);
+      glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0,
+                          atlasWidth, atlasHeight);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &atlasTextureID);
+  }
+  atlasTextureID = texture;
+  for (Character &glyph : glyphs)
+    glyph.TextureID = texture;
 
-  Characters.insert(std::pair<unsigned int, Character>(codepoint, character));
+  // New slots, handed out lowest first
+  uint32_t perLayer = (uint32_t)(slotsPerRow * slotsPerRow);
+  uint32_t first = (uint32_t)layers * perLayer;
+  uint32_t end = (uint32_t)newLayers * perLayer;
+  for (uint32_t slot = end; slot-- > first;)
+    freeSlots.push_back(slot);
+  glyphs.resize(end + 1, glyphs[0]);
+  lastUse.resize(end + 1, 0);
+  codepoints.resize(end + 1, NO_CODEPOINT);
+  layers = newLayers;
+}
 
-  // Advance cursor
-  atlasX += w + 1;
-  return character;
+bool FontManager::evict() {
+  // Resident glyphs not drawn this frame, oldest first
+  std::vector<std::pair<uint32_t, uint32_t>> candidates; // (stamp, index)
+  for (uint32_t index = 1; index < codepoints.size(); index++) {
+    if (codepoints[index] != NO_CODEPOINT && lastUse[index] != frame)
+      candidates.push_back({lastUse[index], index});
+  }
+  if (candidates.empty())
+    return false;
+
+  // An eighth of the atlas at a time, so a burst of new glyphs doesn't
+  // rescan for every one
+  size_t count = std::max<size_t>((codepoints.size() - 1) / 8, 1);
+  count = std::min(count, candidates.size());
+  std::nth_element(candidates.begin(), candidates.begin() + (count - 1),
+                   candidates.end());
+  for (size_t i = 0; i < count; i++) {
+    uint32_t index = candidates[i].second;
+    tableEntry(codepoints[index]) = 0;
+    codepoints[index] = NO_CODEPOINT;
+    freeSlots.push_back(index - 1);
+  }
+  evictionCount++;
+  return true;
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "config.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
 
 struct Character {
   unsigned int TextureID; // ID handle of the glyph texture
@@ -10,26 +13,102 @@ struct Character {
   // Atlas Coordinates (0.0 - 1.0)
   float tx, ty; // Top-left
   float tw, th; // Width/Height in texture space
+  unsigned int layer = 0; // Atlas array layer
 };
 
+// Glyph atlas in a GL_TEXTURE_2D_ARRAY of square slots, one glyph per slot.
+// Layers are added (doubling) as glyphs arrive, up to a memory budget
+// (TERMINALGL_ATLAS_MB, default 16 MB). Past that, glyphs not used in the
+// current frame are evicted least-recently-used first and their slots
+// reused, so CJK-heavy or emoji output never runs out of glyphs and never
+// grows GPU memory beyond the budget (or the current frame's working set).
 class FontManager {
 public:
   // Atlas State
-  unsigned int atlasTextureID;
+  unsigned int atlasTextureID = 0; // Changes when layers are added
   int atlasWidth = 1024;
   int atlasHeight = 1024;
-  int atlasX = 0;
-  int atlasY = 0;
-  int atlasRowHeight = 0;
 
   FontManager();
   ~FontManager();
 
   bool loadFont(std::string fontPath, unsigned int fontSize);
-  Character getCharacter(unsigned int c);
+  // Glyph for a codepoint, rendered into the atlas on first use. The
+  // reference stays valid until the glyph is evicted, which never happens
+  // to a glyph used in the current frame. Loaded BMP glyphs are two array
+  // loads away.
+  const Character &getCharacter(unsigned int c) {
+    if (c < 0x10000) {
+      const uint32_t *page = pages[c >> 8].get();
+      if (page && page[c & 0xff]) {
+        uint32_t index = page[c & 0xff] - 1;
+        lastUse[index] = frame;
+        return glyphs[index];
+      }
+    }
+    return loadCharacter(c);
+  }
+  // Atlas coordinates of the reserved white pixel at (0, 0) of layer 0,
+  // for drawing solid rectangles with the glyph texture bound
+  glm::vec2 getWhiteUV() const {
+    return glm::vec2(0.5f / atlasWidth, 0.5f / atlasHeight);
+  }
+
+  // Starts a frame: glyphs looked up from now on are protected from
+  // eviction until the next call
+  void beginFrame() { frame++; }
+  // Bumped whenever glyphs are evicted; geometry cached across frames must
+  // be rebuilt when it changes
+  uint64_t getEvictionCount() const { return evictionCount; }
 
 private:
   FT_Library ft;
   FT_Face face;
-  std::map<unsigned int, Character> Characters;
+
+  // One record per atlas slot (index = slot + 1); entry 0 is the empty
+  // glyph used for codepoints that fail to load. A deque so references
+  // survive growth.
+  std::deque<Character> glyphs;
+  std::vector<uint32_t> lastUse;   // Frame stamp per record
+  std::vector<uint32_t> codepoints; // Owner of each record, for eviction
+  static constexpr uint32_t NO_CODEPOINT = UINT32_MAX; // Free record
+  std::vector<uint32_t> freeSlots;
+  uint32_t frame = 1;
+  uint64_t evictionCount = 0;
+
+  // Slot geometry and layer bookkeeping
+  int slotSize = 0;
+  int slotsPerRow = 0;
+  int layers = 0;
+  int maxLayers = 16;
+  bool overBudgetReported = false;
+  std::vector<uint8_t> staging; // One slot's pixels
+
+  // Lookup tables hold glyph index + 1, so 0 means "not loaded yet".
+  // The BMP is 256 dense pages of 256 entries, allocated on first use;
+  // page 0 (ASCII, Latin-1) always exists.
+  std::unique_ptr<uint32_t[]> pages[256];
+  // Codepoints beyond the BMP: open addressing with linear probing
+  // (codepoint 0 marks a free slot, it always lives in page 0)
+  struct AstralSlot {
+    uint32_t codepoint;
+    uint32_t entry;
+  };
+  std::vector<AstralSlot> astral;
+  size_t astralCount = 0;
+
+  // getCharacter's slow path: finds or creates the table entry and loads
+  const Character &loadCharacter(unsigned int c);
+  uint32_t &tableEntry(unsigned int c);
+  void growAstral();
+  // Renders a glyph into the atlas; its index in glyphs (0 if the font
+  // can't render it, -1 if no slot could be found)
+  int64_t loadGlyph(unsigned int c);
+
+  // A free slot, adding layers or evicting as needed; -1 if none
+  int64_t allocateSlot();
+  // Resizes the texture array, copying the existing layers
+  void addLayers(int count);
+  // Frees the least recently used part of the atlas (never this frame's)
+  bool evict();
 };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Shader.h"
+#include "config.h"
+#include <cstddef>
+
+// Per-view and per-frame constants shared by every shader through one
+// uniform buffer, bound at Shader::FRAME_BLOCK_BINDING:
+//
+//   layout (std140) uniform Frame {
+//       mat4 projection; // Pixels to clip space
+//       vec2 viewport;   // Framebuffer size in pixels
+//       float time;      // Seconds since start
+//   };
+//
+// Each setter uploads only the fields whose value changed.
+class FrameUniforms {
+public:
+  FrameUniforms() {
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), &block, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FRAME_BLOCK_BINDING, UBO);
+  }
+  ~FrameUniforms() { glDeleteBuffers(1, &UBO); }
+  FrameUniforms(const FrameUniforms &) = delete;
+  FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+  void setViewport(float width, float height) {
+    if (block.viewport.x == width && block.viewport.y == height)
+      return;
+    block.projection = glm::ortho(0.0f, width, 0.0f, height);
+    block.viewport = glm::vec2(width, height);
+    upload(offsetof(Block, projection),
+           offsetof(Block, time) - offsetof(Block, projection));
+  }
+
+  void setTime(float time) {
+    if (block.time == time)
+      return;
+    block.time = time;
+    upload(offsetof(Block, time), sizeof(float));
+  }
+
+private:
+  // std140 layout of the Frame block
+  struct Block {
+    glm::mat4 projection{1.0f};
+    glm::vec2 viewport{0.0f};
+    float time = 0.0f;
+    float padding = 0.0f;
+  };
+  static_assert(sizeof(Block) == 80, "Block must match the std140 layout");
+
+  unsigned int UBO = 0;
+  Block block;
+
+  void upload(size_t offset, size_t size) {
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size,
+                    (const char *)&block + offset);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+};
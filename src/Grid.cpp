@@ -0,0 +1,178 @@
+#include "Grid.h"
+#include <algorithm>
+
+// Rows allocated up front; storage doubles from here up to the ring size
+static const size_t INITIAL_ROWS = 64;
+
+Grid::Grid(size_t columns, size_t maxLines, size_t hotLines)
+    : columns(std::max<size_t>(columns, 1)),
+      maxLines(std::max<size_t>(maxLines, 1)),
+      ringCapacity(ringCapacityFor(this->maxLines, hotLines)) {
+  clear();
+}
+
+size_t Grid::ringCapacityFor(size_t maxLines, size_t hotLines) {
+  // A page of slack above hotLines lets eviction move whole pages
+  if (hotLines >= maxLines - std::min(maxLines, Scrollback::PAGE_LINES))
+    return maxLines;
+  return std::max<size_t>(hotLines, 1) + Scrollback::PAGE_LINES;
+}
+
+Grid::Row Grid::operator[](size_t line) const {
+  if (line < history.size()) {
+    RowInfo lineInfo;
+    const Cell *lineCells = history.getLine(line, lineInfo);
+    return Row(lineCells, lineInfo.length);
+  }
+  size_t row = physical(line);
+  return Row(&cells[row * columns], info[row].length);
+}
+
+void Grid::blankRow(size_t physicalRow) {
+  std::fill_n(&cells[physicalRow * columns], columns, BLANK);
+  info[physicalRow] = RowInfo();
+  generations[physicalRow] = ++generationClock;
+}
+
+void Grid::truncate(size_t line, size_t col) {
+  RowInfo &row = info[physical(line)];
+  if (col >= row.length)
+    return;
+  Cell *lineCells = rowCells(line);
+  std::fill(lineCells + col, lineCells + row.length, BLANK);
+  row.length = (uint16_t)col;
+  row.wrapped = false;
+}
+
+void Grid::evictToHistory(size_t n) {
+  std::vector<Cell> pageCells;
+  std::vector<RowInfo> pageLines(n);
+  size_t total = 0;
+  for (size_t i = 0; i < n; i++)
+    total += info[(head + i) % allocatedRows].length;
+  pageCells.reserve(total);
+
+  for (size_t i = 0; i < n; i++) {
+    size_t row = (head + i) % allocatedRows;
+    const Cell *rowStart = &cells[row * columns];
+    pageCells.insert(pageCells.end(), rowStart, rowStart + info[row].length);
+    pageLines[i] = info[row];
+  }
+  head = (head + n) % allocatedRows;
+  count -= n;
+  history.pushPage(std::move(pageCells), std::move(pageLines));
+}
+
+size_t Grid::enforceLimit() {
+  size_t total = size();
+  if (total <= maxLines)
+    return 0;
+  size_t drop = std::min(total - maxLines, history.size());
+  history.dropOldest(drop);
+  firstLineId += drop;
+  return drop;
+}
+
+size_t Grid::pushLine() {
+  if (count == ringCapacity) {
+    if (ringCapacity == maxLines && history.size() == 0) {
+      // Full, no history: the oldest row becomes the newest
+      size_t row = head;
+      head = head + 1 == allocatedRows ? 0 : head + 1;
+      blankRow(row);
+      firstLineId++;
+      return 1;
+    }
+    evictToHistory(std::min(Scrollback::PAGE_LINES, count - 1));
+  }
+
+  if (count == allocatedRows) {
+    // Still growing towards ringCapacity. The ring hasn't wrapped yet (head
+    // is 0 until it first fills), so plain vector growth keeps the order.
+    allocatedRows =
+        std::min(std::max(allocatedRows * 2, INITIAL_ROWS), ringCapacity);
+    // Exact reserve: vector growth alone could overshoot the bound
+    cells.reserve(allocatedRows * columns);
+    info.reserve(allocatedRows);
+    generations.reserve(allocatedRows);
+    cells.resize(allocatedRows * columns, BLANK);
+    info.resize(allocatedRows);
+    generations.resize(allocatedRows);
+  }
+  blankRow((head + count) % allocatedRows);
+  count++;
+  return enforceLimit();
+}
+
+void Grid::clear() {
+  // New lines get new ids, so nothing matches what was there before
+  firstLineId += size();
+  history.clear();
+  head = 0;
+  count = 0;
+  if (allocatedRows == 0) {
+    pushLine();
+  } else {
+    blankRow(0);
+    count = 1;
+  }
+}
+
+void Grid::resize(size_t newColumns, size_t newMaxLines, size_t hotLines) {
+  newColumns = std::max<size_t>(newColumns, 1);
+  newMaxLines = std::max<size_t>(newMaxLines, 1);
+  size_t newRingCapacity = ringCapacityFor(newMaxLines, hotLines);
+  if (newColumns == columns && newMaxLines == maxLines &&
+      newRingCapacity == ringCapacity)
+    return;
+
+  // Hot lines that no longer fit the ring become history (when there is
+  // any); the rest of the excess is dropped below
+  if (count > newRingCapacity &&
+      (newRingCapacity < newMaxLines || history.size() > 0))
+    evictToHistory(count - newRingCapacity);
+
+  size_t keep = std::min(count, newRingCapacity);
+  size_t first = count - keep;
+  size_t rows = std::max(keep, std::min(INITIAL_ROWS, newRingCapacity));
+  size_t copyColumns = std::min(columns, newColumns);
+
+  std::vector<Cell> newCells(rows * newColumns, BLANK);
+  std::vector<RowInfo> newInfo(rows);
+  for (size_t i = 0; i < keep; i++) {
+    size_t row = (head + first + i) % allocatedRows;
+    const Cell *src = &cells[row * columns];
+    std::copy(src, src + copyColumns, &newCells[i * newColumns]);
+    RowInfo rowInfo = info[row];
+    if (rowInfo.length > newColumns) {
+      rowInfo.length = (uint16_t)newColumns;
+      rowInfo.wrapped = false;
+    }
+    newInfo[i] = rowInfo;
+  }
+
+  // Every row is laid out anew
+  generationClock++;
+  std::vector<uint64_t> newGenerations(rows, generationClock);
+
+  cells.swap(newCells);
+  info.swap(newInfo);
+  generations.swap(newGenerations);
+  firstLineId += first;
+  columns = newColumns;
+  maxLines = newMaxLines;
+  ringCapacity = newRingCapacity;
+  allocatedRows = rows;
+  head = 0;
+  count = keep;
+  enforceLimit();
+}
+
+Grid::MemoryStats Grid::getMemoryStats() const {
+  MemoryStats stats;
+  stats.ringBytes = cells.capacity() * sizeof(Cell) +
+                    info.capacity() * sizeof(RowInfo) +
+                    generations.capacity() * sizeof(uint64_t);
+  stats.scrollback = history.getStats();
+  return stats;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Cell.h"
+#include "Scrollback.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Line storage for a Terminal: the visible screen and recent scrollback as a
+// ring of fixed-width rows in one contiguous Cell array (the hot lines),
+// with older history compressed in a Scrollback behind it.
+//
+// Lines are addressed logically, 0 = oldest, history first. Appending a line
+// once the ring is full advances the head over the oldest row (or moves the
+// oldest page of rows into the Scrollback), so steady-state output never
+// grows the ring and the total stays bounded at maxLines. Ring storage grows
+// (doubling) until it first fills.
+//
+// Damage tracking: every line has a stable id (it doesn't change when older
+// lines are dropped) and a generation that every mutation of the line bumps,
+// including handing out its cells through rowCells(). A consumer that
+// remembers (id, generation) per row can tell exactly which rows changed.
+class Grid {
+public:
+  // Read-only view of one line: the cells in use, [0, size())
+  class Row {
+  public:
+    Row(const Cell *cells, size_t length) : cells(cells), length(length) {}
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    const Cell &operator[](size_t col) const { return cells[col]; }
+    const Cell *begin() const { return cells; }
+    const Cell *end() const { return cells + length; }
+
+  private:
+    const Cell *cells;
+    size_t length;
+  };
+
+  static constexpr Cell BLANK{' ', 0, COLOR_DEFAULT_FG, COLOR_DEFAULT_BG};
+
+  struct MemoryStats {
+    size_t ringBytes = 0; // Screen + hot lines
+    Scrollback::Stats scrollback;
+    size_t total() const { return ringBytes + scrollback.total(); }
+  };
+
+  // hotLines bounds the uncompressed ring (plus one page of slack); lines
+  // beyond it go to the compressed Scrollback. The default keeps everything
+  // in the ring.
+  Grid(size_t columns, size_t maxLines, size_t hotLines = SIZE_MAX);
+
+  size_t size() const { return history.size() + count; }
+  size_t getColumns() const { return columns; }
+  size_t getMaxLines() const { return maxLines; }
+  // First line that lives in the ring, i.e. can be written to
+  size_t getFirstHotLine() const { return history.size(); }
+
+  // History lines are valid until the next access to another history page
+  Row operator[](size_t line) const;
+
+  // Full-width mutable cells of a hot line; cells past getLength() are blank.
+  // Marks the line as changed.
+  Cell *rowCells(size_t line) {
+    size_t row = physical(line);
+    generations[row] = ++generationClock;
+    return &cells[row * columns];
+  }
+  size_t getLength(size_t line) const { return getInfo(line).length; }
+  void setLength(size_t line, size_t length) {
+    size_t row = physical(line);
+    info[row].length = (uint16_t)length;
+    generations[row] = ++generationClock;
+  }
+  // Blanks a hot line from col to the end and shortens it to col
+  void truncate(size_t line, size_t col);
+
+  // Set on a line whose text ran past the last column and continues on the
+  // next line (autowrap), so selection can join them without a newline
+  bool isWrapped(size_t line) const { return getInfo(line).wrapped; }
+  void setWrapped(size_t line, bool wrapped) {
+    size_t row = physical(line);
+    info[row].wrapped = wrapped;
+    generations[row] = ++generationClock;
+  }
+
+  // Stable identity of a line: its index counted from the first line ever
+  // pushed, so it survives older lines being dropped
+  uint64_t getLineId(size_t line) const { return firstLineId + line; }
+  // Changes whenever the line does. History lines are immutable and report
+  // 0 (a line moving into history counts as one last change).
+  uint64_t getGeneration(size_t line) const {
+    return line < history.size() ? 0 : generations[physical(line)];
+  }
+
+  // Appends a blank line. Returns how many of the oldest lines were dropped
+  // to stay within maxLines (every line index moved down by that much).
+  size_t pushLine();
+  // Drops everything, history included, leaving a single blank line
+  void clear();
+
+  // Changing the width or the limits re-lays out the ring (rare: window
+  // resizes). Rows are cut or padded, not re-wrapped; the newest lines are
+  // kept when the limit shrinks. History keeps its original widths.
+  void resize(size_t columns, size_t maxLines, size_t hotLines = SIZE_MAX);
+
+  // See Scrollback::enableSpill
+  bool enableSpill(size_t residentBytes) {
+    return history.enableSpill(residentBytes);
+  }
+
+  MemoryStats getMemoryStats() const;
+  size_t memoryUsage() const { return getMemoryStats().total(); }
+  // Blocks until history handed to the background compressor is packed
+  void waitForCompression() const { history.waitForCompression(); }
+
+private:
+  using RowInfo = Scrollback::LineInfo;
+
+  size_t columns;
+  size_t maxLines;
+  size_t ringCapacity; // Hot rows, <= maxLines
+  size_t allocatedRows = 0;
+  size_t head = 0;  // Physical row of the first hot line
+  size_t count = 0; // Hot lines
+  std::vector<Cell> cells;
+  std::vector<RowInfo> info;
+  std::vector<uint64_t> generations; // Per ring row
+  uint64_t generationClock = 0;
+  uint64_t firstLineId = 0;
+  Scrollback history;
+
+  static size_t ringCapacityFor(size_t maxLines, size_t hotLines);
+
+  // Physical ring row of a (logical) hot line
+  size_t physical(size_t line) const {
+    size_t row = head + (line - history.size());
+    return row < allocatedRows ? row : row - allocatedRows;
+  }
+  RowInfo getInfo(size_t line) const {
+    if (line < history.size())
+      return history.getLineInfo(line);
+    return info[physical(line)];
+  }
+  void blankRow(size_t physicalRow);
+  // Moves the oldest n hot lines into the Scrollback as one page
+  void evictToHistory(size_t n);
+  size_t enforceLimit();
+};
@@ -0,0 +1,295 @@
+#include "GridRenderer.h"
+#include "Cell.h"
+#include "FontManager.h"
+#include "Shader.h"
+#include "Terminal.h"
+#include <algorithm>
+#include <cstddef>
+
+// Texture units for the buffer textures (the atlas is on unit 0)
+static const int METRICS_UNIT = 1;
+static const int PALETTE_UNIT = 2;
+// Floats of glyph metrics per slot (three RGBA32F texels)
+static const size_t METRICS_STRIDE = 12;
+
+GridRenderer::GridRenderer() {
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &instanceVBO);
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+  // No per-vertex data: the corners come from gl_VertexID
+  glEnableVertexAttribArray(0);
+  glVertexAttribIPointer(0, 2, GL_UNSIGNED_SHORT, sizeof(Instance),
+                         (void *)offsetof(Instance, col));
+  glVertexAttribDivisor(0, 1);
+  glEnableVertexAttribArray(1);
+  glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(Instance),
+                         (void *)offsetof(Instance, glyph));
+  glVertexAttribDivisor(1, 1);
+  glEnableVertexAttribArray(2);
+  glVertexAttribIPointer(2, 2, GL_UNSIGNED_SHORT, sizeof(Instance),
+                         (void *)offsetof(Instance, fg));
+  glVertexAttribDivisor(2, 1);
+  glEnableVertexAttribArray(3);
+  glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(Instance),
+                         (void *)offsetof(Instance, flags));
+  glVertexAttribDivisor(3, 1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  glGenBuffers(1, &metricsBuffer);
+  glGenTextures(1, &metricsTexture);
+  glGenBuffers(1, &paletteBuffer);
+  glGenTextures(1, &paletteTexture);
+
+
+  createShader();
+}
+
+GridRenderer::~GridRenderer() {
+  glDeleteVertexArrays(1, &VAO);
+  glDeleteBuffers(1, &instanceVBO);
+  glDeleteBuffers(1, &metricsBuffer);
+  glDeleteTextures(1, &metricsTexture);
+  glDeleteBuffers(1, &paletteBuffer);
+  glDeleteTextures(1, &paletteTexture);
+  delete shader;
+}
+
+void GridRenderer::createShader() {
+  const char *vs = R"(
+        #version 330 core
+        layout (location = 0) in uvec2 aCell;   // col, row
+        layout (location = 1) in uint aGlyph;
+        layout (location = 2) in uvec2 aColors; // fg, bg palette indices
+        layout (location = 3) in uint aFlags;
+
+        layout (std140) uniform Frame {
+            mat4 projection;
+            vec2 viewport;
+            float time;
+        };
+        uniform vec2 origin;    // Left edge and baseline of row 0
+        uniform vec2 cellSize;  // Cell width, line height
+        uniform float scale;
+        uniform int pass;       // 0 backgrounds, 1 glyphs, 2 decorations
+        uniform samplerBuffer metrics;
+        uniform samplerBuffer palette;
+
+        out vec2 TexCoords;
+        out vec2 CellPos;       // Pixels from the cell's bottom-left corner
+        flat out vec3 Fg;
+        flat out vec3 Bg;
+        flat out uint Flags;
+        flat out float Layer;
+
+        void main() {
+            vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+            vec2 base = origin + vec2(float(aCell.x), -float(aCell.y)) *
+                                 cellSize;
+            Fg = texelFetch(palette, int(aColors.x)).rgb;
+            Bg = texelFetch(palette, int(aColors.y)).rgb;
+            if ((aFlags & 2u) != 0u) // ATTR_DIM
+                Fg *= 0.6;
+            Flags = aFlags;
+            TexCoords = vec2(0.0);
+            CellPos = corner * cellSize;
+            Layer = 0.0;
+
+            vec2 pos;
+            if (pass == 1) {
+                vec4 m = texelFetch(metrics, int(aGlyph) * 3);      // bearing, size
+                vec4 uv = texelFetch(metrics, int(aGlyph) * 3 + 1); // atlas rect
+                Layer = texelFetch(metrics, int(aGlyph) * 3 + 2).x;
+                vec2 bottomLeft = base + vec2(m.x, m.y - m.w) * scale;
+                pos = bottomLeft + corner * m.zw * scale;
+                TexCoords = vec2(uv.x + corner.x * uv.z,
+                                 uv.y + (1.0 - corner.y) * uv.w);
+            } else {
+                pos = base + CellPos;
+            }
+            // Cells with nothing to draw in this pass collapse to a point
+            bool empty = pass == 0 ? (aFlags & 32768u) == 0u
+                       : pass == 1 ? (aFlags & 128u) != 0u     // ATTR_INVISIBLE
+                                   : (aFlags & 264u) == 0u;    // UNDERLINE|STRIKE
+            if (empty)
+                pos = base;
+            gl_Position = projection * vec4(pos, 0.0, 1.0);
+        }
+    )";
+
+  const char *fs = R"(
+        #version 330 core
+        in vec2 TexCoords;
+        in vec2 CellPos;
+        flat in vec3 Fg;
+        flat in vec3 Bg;
+        flat in uint Flags;
+        flat in float Layer;
+
+        uniform int pass;
+        uniform vec2 cellSize;
+        uniform float scale;
+        uniform sampler2DArray atlas;
+
+        out vec4 color;
+
+        void main() {
+            if (pass == 0) {
+                color = vec4(Bg, 1.0);
+            } else if (pass == 1) {
+                color = vec4(Fg, texture(atlas, vec3(TexCoords, Layer)).r);
+            } else {
+                float strikeY = cellSize.y * 0.4;
+                bool underline = (Flags & 8u) != 0u &&
+                                 CellPos.y >= 2.0 * scale &&
+                                 CellPos.y < 3.0 * scale;
+                bool strike = (Flags & 256u) != 0u && CellPos.y >= strikeY &&
+                              CellPos.y < strikeY + scale;
+                if (!underline && !strike)
+                    discard;
+                color = vec4(Fg, 1.0);
+            }
+        }
+    )";
+
+  shader = new Shader(vs, fs, true);
+  uniforms.origin = shader->uniform<glm::vec2>("origin");
+  uniforms.cellSize = shader->uniform<glm::vec2>("cellSize");
+  uniforms.scale = shader->uniform<float>("scale");
+  uniforms.pass = shader->uniform<int>("pass");
+
+  // Samplers never change units
+  shader->use();
+  shader->set(shader->uniform<int>("atlas"), 0);
+  shader->set(shader->uniform<int>("metrics"), METRICS_UNIT);
+  shader->set(shader->uniform<int>("palette"), PALETTE_UNIT);
+}
+
+void GridRenderer::reset(size_t rowCount, size_t colCount) {
+  rows = rowCount;
+  cols = colCount;
+  rowInstances.resize(cols);
+
+  // Slot 0: the empty glyph (zero size draws nothing)
+  glyphSlots.clear();
+  metrics.assign(METRICS_STRIDE, 0.0f);
+  metricsDirty = true;
+
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferData(GL_ARRAY_BUFFER, rows * cols * sizeof(Instance), NULL,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  for (size_t row = 0; row < rows; row++)
+    setRow(row, {});
+}
+
+uint16_t GridRenderer::glyphSlot(FontManager &fontManager,
+                                 uint32_t codepoint) {
+  auto it = glyphSlots.find(codepoint);
+  if (it != glyphSlots.end())
+    return it->second;
+
+  // Out of 16-bit slots: draw as blank rather than alias another glyph
+  size_t slot = metrics.size() / METRICS_STRIDE;
+  if (slot > UINT16_MAX)
+    return 0;
+
+  const Character &ch = fontManager.getCharacter(codepoint);
+  float entry[METRICS_STRIDE] = {
+      (float)ch.Bearing.x, (float)ch.Bearing.y, (float)ch.Size.x,
+      (float)ch.Size.y,    ch.tx,               ch.ty,
+      ch.tw,               ch.th,               (float)ch.layer,
+      0.0f,                0.0f,                0.0f};
+  metrics.insert(metrics.end(), entry, entry + METRICS_STRIDE);
+  metricsDirty = true;
+  glyphSlots[codepoint] = (uint16_t)slot;
+  return (uint16_t)slot;
+}
+
+void GridRenderer::setRow(size_t row, const std::vector<Instance> &cells) {
+  if (row >= rows || cols == 0)
+    return;
+  // Positions are fixed by the slot, so blanks only need col/row filled in
+  size_t count = std::min(cells.size(), cols);
+  for (size_t col = 0; col < cols; col++) {
+    rowInstances[col] = col < count ? cells[col]
+                                : Instance{0, 0, 0, COLOR_DEFAULT_FG,
+                                           COLOR_DEFAULT_BG, 0};
+    rowInstances[col].col = (uint16_t)col;
+    rowInstances[col].row = (uint16_t)row;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferSubData(GL_ARRAY_BUFFER, row * cols * sizeof(Instance),
+                  cols * sizeof(Instance), rowInstances.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static uint8_t toByte(float channel) {
+  return (uint8_t)(std::min(std::max(channel, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+void GridRenderer::uploadPalette(const Terminal &terminal) {
+  size_t count = terminal.getColorCount();
+  if (count == paletteSize)
+    return;
+
+  // Existing entries never change, but the buffer is small: redo it all
+  std::vector<uint8_t> texels(count * 4);
+  for (size_t i = 0; i < count; i++) {
+    Terminal::Color color = terminal.resolveColor((uint16_t)i);
+    texels[i * 4 + 0] = toByte(color.r);
+    texels[i * 4 + 1] = toByte(color.g);
+    texels[i * 4 + 2] = toByte(color.b);
+    texels[i * 4 + 3] = 255;
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, paletteBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, texels.size(), texels.data(),
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, paletteBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  paletteSize = count;
+}
+
+void GridRenderer::draw(const Terminal &terminal, FontManager &fontManager,
+                        float cellWidth, float originX, float originY) {
+  if (rows == 0 || cols == 0)
+    return;
+
+  uploadPalette(terminal);
+  if (metricsDirty) {
+    glBindBuffer(GL_TEXTURE_BUFFER, metricsBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, metrics.size() * sizeof(float),
+                 metrics.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, metricsTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, metricsBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    metricsDirty = false;
+  }
+
+  shader->use();
+  shader->set(uniforms.origin, glm::vec2(originX, originY));
+  shader->set(uniforms.cellSize,
+              glm::vec2(cellWidth, terminal.getLineHeight()));
+  shader->set(uniforms.scale, terminal.getScale());
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, fontManager.atlasTextureID);
+  glActiveTexture(GL_TEXTURE0 + METRICS_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, metricsTexture);
+  glActiveTexture(GL_TEXTURE0 + PALETTE_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+  glActiveTexture(GL_TEXTURE0);
+
+  glBindVertexArray(VAO);
+  for (int pass = 0; pass < 3; pass++) {
+    shader->set(uniforms.pass, pass);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(rows * cols));
+  }
+  glBindVertexArray(0);
+}
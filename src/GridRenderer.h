@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Shader.h"
+#include "config.h"
+#include <cstdint>
+#include <unordered_map>
+
+class FontManager;
+class Terminal;
+
+// Instanced renderer for the terminal grid. Each cell is one 12-byte
+// instance (grid position, glyph slot, palette indices, attribute flags)
+// and the vertex shader builds the quads, reading glyph metrics and colors
+// from buffer textures. Compared with expanding every glyph into six
+// vertices on the CPU that is about a tenth of the upload per cell, which
+// keeps large windows with small fonts cheap.
+//
+// Instances live in one slot per screen row (like RowCache), rewritten only
+// when the row is damaged. draw() is three instanced calls over the same
+// instances: cell backgrounds, glyphs, then underline/strikethrough.
+class GridRenderer {
+public:
+  struct Instance {
+    uint16_t col, row;
+    uint16_t glyph;  // Slot from glyphSlot(); 0 is the empty glyph
+    uint16_t fg, bg; // Palette indices (see CellColor)
+    uint16_t flags;  // CellAttribute bits, plus FLAG_BACKGROUND
+  };
+  // Set when bg is not the default background; other cells emit no quad in
+  // the background pass
+  static constexpr uint16_t FLAG_BACKGROUND = 1 << 15;
+
+  GridRenderer();
+  ~GridRenderer();
+  GridRenderer(const GridRenderer &) = delete;
+  GridRenderer &operator=(const GridRenderer &) = delete;
+
+  // Blanks every slot and sizes the buffer for rows x cols cells. Glyph
+  // slots are forgotten too (atlas positions change on eviction).
+  void reset(size_t rows, size_t cols);
+  // Metrics slot for a codepoint, loading the glyph on first use
+  uint16_t glyphSlot(FontManager &fontManager, uint32_t codepoint);
+  // Replaces a row's cells; slots past cells.size() are blanked
+  void setRow(size_t row, const std::vector<Instance> &cells);
+
+  // cellWidth/lineHeight in pixels; the first row's baseline is at originY
+  void draw(const Terminal &terminal, FontManager &fontManager,
+            float cellWidth, float originX, float originY);
+
+private:
+  Shader *shader = nullptr;
+  struct {
+    Shader::Uniform<glm::vec2> origin, cellSize;
+    Shader::Uniform<float> scale;
+    Shader::Uniform<int> pass;
+  } uniforms;
+  unsigned int VAO = 0, instanceVBO = 0;
+  size_t rows = 0, cols = 0;
+  std::vector<Instance> rowInstances; // Scratch for setRow
+
+  // Glyph metrics: three RGBA32F texels per slot, (bearing, size) in
+  // pixels, the atlas rectangle (tx, ty, tw, th) and (layer, 0, 0, 0)
+  unsigned int metricsBuffer = 0, metricsTexture = 0;
+  std::unordered_map<uint32_t, uint16_t> glyphSlots;
+  std::vector<float> metrics;
+  bool metricsDirty = true;
+
+  // Palette: one RGBA8 texel per color index, re-uploaded as it grows
+  unsigned int paletteBuffer = 0, paletteTexture = 0;
+  size_t paletteSize = 0;
+
+  void createShader();
+  void uploadPalette(const Terminal &terminal);
+};
@@ -0,0 +1,153 @@
+#include "Lz4.h"
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+// Format rules: the last 5 bytes are always literals and the last match
+// must start at least 12 bytes before the end
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_FIND_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 12;
+
+static uint32_t read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// Misses in a row before the search starts skipping ahead; incompressible
+// stretches are then crossed in growing strides
+static const int SKIP_TRIGGER = 6;
+
+static uint64_t read64(const uint8_t *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t hash4(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Writes a length of the form "nibble, then 255-byte continuation"
+static uint8_t *writeLength(uint8_t *op, size_t length) {
+  for (; length >= 255; length -= 255)
+    *op++ = 255;
+  *op++ = (uint8_t)length;
+  return op;
+}
+
+static uint8_t *writeSequence(uint8_t *op, const uint8_t *literals,
+                              size_t literalLength, size_t offset,
+                              size_t matchLength) {
+  uint8_t *token = op++;
+  *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+  if (literalLength >= 15)
+    op = writeLength(op, literalLength - 15);
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+
+  if (matchLength == 0)
+    return op; // Last sequence: literals only
+
+  *op++ = (uint8_t)(offset & 0xFF);
+  *op++ = (uint8_t)(offset >> 8);
+  size_t code = matchLength - MIN_MATCH;
+  *token |= (uint8_t)(code >= 15 ? 15 : code);
+  if (code >= 15)
+    op = writeLength(op, code - 15);
+  return op;
+}
+
+size_t lz4Compress(const uint8_t *src, size_t size, uint8_t *dst) {
+  uint8_t *op = dst;
+  size_t anchor = 0;
+
+  if (size > MATCH_FIND_LIMIT) {
+    // Positions + 1, so 0 means empty
+    uint32_t table[1 << HASH_BITS] = {};
+    size_t matchLimit = size - LAST_LITERALS;
+    size_t ip = 0;
+    size_t misses = 0;
+
+    while (ip < size - MATCH_FIND_LIMIT) {
+      uint32_t sequence = read32(src + ip);
+      uint32_t h = hash4(sequence);
+      size_t candidate = table[h];
+      table[h] = (uint32_t)(ip + 1);
+
+      if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET ||
+          read32(src + candidate - 1) != sequence) {
+        ip += 1 + (misses++ >> SKIP_TRIGGER);
+        continue;
+      }
+      misses = 0;
+
+      size_t ref = candidate - 1;
+      size_t length = MIN_MATCH;
+      // Eight bytes at a time, then the remainder byte by byte
+      while (ip + length + 8 <= matchLimit &&
+             read64(src + ref + length) == read64(src + ip + length))
+        length += 8;
+      while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+        length++;
+
+      op = writeSequence(op, src + anchor, ip - anchor, ip - ref, length);
+      ip += length;
+      anchor = ip;
+    }
+  }
+
+  op = writeSequence(op, src + anchor, size - anchor, 0, 0);
+  return op - dst;
+}
+
+bool lz4Decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                   size_t dstSize) {
+  const uint8_t *ip = src;
+  const uint8_t *end = src + size;
+  size_t op = 0;
+
+  auto readLength = [&](size_t &length) {
+    uint8_t byte;
+    do {
+      if (ip >= end)
+        return false;
+      byte = *ip++;
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !readLength(literalLength))
+      return false;
+    if (literalLength > (size_t)(end - ip) || literalLength > dstSize - op)
+      return false;
+    memcpy(dst + op, ip, literalLength);
+    ip += literalLength;
+    op += literalLength;
+
+    if (ip == end)
+      break; // The last sequence has no match part
+
+    if (end - ip < 2)
+      return false;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(matchLength))
+      return false;
+    matchLength += MIN_MATCH;
+    if (offset == 0 || offset > op || matchLength > dstSize - op)
+      return false;
+
+    // Byte by byte: the match may overlap the bytes it produces
+    for (size_t i = 0; i < matchLength; i++, op++)
+      dst[op] = dst[op - offset];
+  }
+  return op == dstSize;
+}
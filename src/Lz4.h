@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Minimal LZ4 block format codec (https://github.com/lz4/lz4/blob/dev/doc/
+// lz4_Block_format.md) for compressing scrollback pages. Greedy single-probe
+// matching: fast and good enough for terminal text, not the best ratio.
+
+// Worst-case compressed size of size input bytes
+inline size_t lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+// Compresses size bytes from src into dst, which must hold
+// lz4CompressBound(size) bytes. Returns the compressed size.
+size_t lz4Compress(const uint8_t *src, size_t size, uint8_t *dst);
+
+// Decompresses a block that expands to exactly dstSize bytes. Returns false
+// on malformed input instead of reading or writing out of bounds.
+bool lz4Decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                   size_t dstSize);
@@ -1,10 +1,16 @@
 #include "PTYHandler.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 PTYHandler::PTYHandler() : masterFd(-1), pid(-1) {}
 
 PTYHandler::~PTYHandler() {
+  stopReader();
   if (masterFd != -1) {
     close(masterFd);
   }
@@ -58,34 +64,263 @@ bool PTYHandler::spawnShell() {
   int flags = fcntl(masterFd, F_GETFL, 0);
   fcntl(masterFd, F_SETFL, flags | O_NONBLOCK);
 
+  startReader();
   return true;
 }
 
-std::string PTYHandler::readOutput() {
-  char buffer[1024];
-  std::string output = "";
+void PTYHandler::startReader() {
+  if (readerThread.joinable())
+    return;
 
-  while (true) {
-    ssize_t bytesRead = read(masterFd, buffer, sizeof(buffer) - 1);
-    if (bytesRead > 0) {
-      buffer[bytesRead] = '\0';
-      output += buffer;
+  if (pipe(wakePipe) < 0) {
+    perror("pipe");
+    return;
+  }
+  for (int fd : wakePipe) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
+
+  readerRunning.store(true);
+  readerThread = std::thread(&PTYHandler::readerLoop, this);
+}
+
+void PTYHandler::stopReader() {
+  readerRunning.store(false);
+  wakeReader();
+  if (readerThread.joinable()) {
+    readerThread.join();
+  }
+  for (int &fd : wakePipe) {
+    if (fd != -1) {
+      close(fd);
+      fd = -1;
+    }
+  }
+}
+
+void PTYHandler::wakeReader() {
+  if (wakePipe[1] != -1) {
+    char c = 1;
+    // A full pipe already means a wake-up is pending, so EAGAIN is fine
+    (void)!write(wakePipe[1], &c, 1);
+  }
+}
+
+void PTYHandler::readerLoop() {
+  while (readerRunning.load()) {
+    struct pollfd fds[2];
+    fds[0] = {wakePipe[0], POLLIN, 0};
+    fds[1] = {masterFd, 0, 0};
+
+    if (outputRing.freeSpace() > 0) {
+      fds[1].events |= POLLIN;
     } else {
-      // Error or EAGAIN (no more data)
+      // Ring is full: stop reading so the kernel buffer applies backpressure
+      // to the child, and sleep until readOutput() makes room.
+      readerWaitingForSpace.store(true);
+      if (outputRing.freeSpace() > 0) {
+        // Consumer drained between the check and the flag, don't sleep
+        readerWaitingForSpace.store(false);
+        continue;
+      }
+    }
+
+    // Queued input: wait for the fd to become writable as well
+    if (pendingInputBytes.load() > 0) {
+      fds[1].events |= POLLOUT;
+    }
+    int nfds = fds[1].events ? 2 : 1;
+
+    if (poll(fds, nfds, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("poll");
       break;
     }
+
+    if (fds[0].revents & POLLIN) {
+      char drain[64];
+      while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+
+    if (nfds < 2)
+      continue;
+
+    if (fds[1].revents & POLLOUT) {
+      std::lock_guard<std::mutex> lock(inputMutex);
+      flushInputLocked();
+    }
+
+    if (!(fds[1].revents & (POLLIN | POLLHUP | POLLERR)))
+      continue;
+
+    // Read until the fd is empty or the ring is full. Each read asks for all
+    // of the ring's free space at once (up to OUTPUT_RING_SIZE) and lands
+    // directly in ring memory, so there is no bounce buffer.
+    bool gotOutput = false;
+    while (true) {
+      struct iovec regions[2];
+      char *first, *second;
+      size_t firstLen, secondLen;
+      if (outputRing.writeRegions(first, firstLen, second, secondLen) == 0)
+        break;
+      regions[0] = {first, firstLen};
+      regions[1] = {second, secondLen};
+
+      ssize_t bytesRead = readv(masterFd, regions, secondLen > 0 ? 2 : 1);
+      if (bytesRead > 0) {
+        recordOutput(first, firstLen, second, bytesRead);
+        outputRing.commitWrite(bytesRead);
+        gotOutput = true;
+      } else if (bytesRead < 0 && errno == EINTR) {
+        continue;
+      } else if (bytesRead < 0 && errno == EAGAIN) {
+        break;
+      } else {
+        // EOF or EIO: the child closed its side
+        readerRunning.store(false);
+        break;
+      }
+    }
+
+    if (gotOutput && outputCallback) {
+      outputCallback();
+    }
+  }
+}
+
+void PTYHandler::setOutputCallback(std::function<void()> callback) {
+  outputCallback = std::move(callback);
+}
+
+std::string_view PTYHandler::readOutput(std::vector<char> &buffer) {
+  size_t available = outputRing.size();
+  if (buffer.size() < available) {
+    buffer.resize(available);
+  }
+  size_t bytesRead = outputRing.read(buffer.data(), available);
+
+  // Reader parked on a full ring, let it continue now there is room
+  if (readerWaitingForSpace.exchange(false)) {
+    wakeReader();
   }
-  return output;
+  return std::string_view(buffer.data(), bytesRead);
 }
 
 void PTYHandler::writeInput(const char *input, size_t size) {
-  if (masterFd != -1) {
-    write(masterFd, input, size);
+  if (masterFd == -1 || size == 0)
+    return;
+
+  std::lock_guard<std::mutex> lock(inputMutex);
+
+  // Fast path: nothing queued, so try to hand it straight to the kernel
+  if (inputQueue.size() == inputQueueOffset) {
+    inputQueue.clear();
+    inputQueueOffset = 0;
+    while (size > 0) {
+      ssize_t written = write(masterFd, input, size);
+      if (written > 0) {
+        input += written;
+        size -= written;
+      } else if (written < 0 && errno == EINTR) {
+        continue;
+      } else {
+        break; // EAGAIN (kernel buffer full) or error: queue the rest
+      }
+    }
+    if (size == 0)
+      return;
   }
+
+  inputQueue.insert(inputQueue.end(), input, input + size);
+  pendingInputBytes.store(inputQueue.size() - inputQueueOffset);
+
+  // Let the reader thread start polling for POLLOUT
+  wakeReader();
 }
 
-void PTYHandler::writeInput(std::string input) {
-  writeInput(input.c_str(), input.length());
+void PTYHandler::writeInput(std::string_view input) {
+  writeInput(input.data(), input.size());
+}
+
+void PTYHandler::pasteInput(std::string_view text, bool bracketed) {
+  if (!bracketed) {
+    writeInput(text);
+    return;
+  }
+
+  // Strip any end marker inside the pasted text so it can't break out of
+  // the bracket and be interpreted as typed commands.
+  static const std::string_view endMarker = "\033[201~";
+  writeInput("\033[200~");
+  size_t start = 0;
+  size_t found;
+  while ((found = text.find(endMarker, start)) != std::string_view::npos) {
+    writeInput(text.substr(start, found - start));
+    start = found + endMarker.size();
+  }
+  writeInput(text.substr(start));
+  writeInput(endMarker);
+}
+
+size_t PTYHandler::getPendingInput() const { return pendingInputBytes.load(); }
+
+void PTYHandler::flushInputLocked() {
+  while (inputQueueOffset < inputQueue.size()) {
+    ssize_t written = write(masterFd, inputQueue.data() + inputQueueOffset,
+                            inputQueue.size() - inputQueueOffset);
+    if (written > 0) {
+      inputQueueOffset += written;
+    } else if (written < 0 && errno == EINTR) {
+      continue;
+    } else {
+      break;
+    }
+  }
+
+  if (inputQueueOffset == inputQueue.size()) {
+    // Keep the capacity around for the next paste
+    inputQueue.clear();
+    inputQueueOffset = 0;
+  } else if (inputQueueOffset > inputQueue.size() / 2) {
+    // Compact so a long drain doesn't keep the consumed prefix alive
+    inputQueue.erase(inputQueue.begin(),
+                     inputQueue.begin() + inputQueueOffset);
+    inputQueueOffset = 0;
+  }
+  pendingInputBytes.store(inputQueue.size() - inputQueueOffset);
+}
+
+bool PTYHandler::startRecording(const std::string &path) {
+  std::lock_guard<std::mutex> lock(recorderMutex);
+  if (!recorder.open(path))
+    return false;
+  recording.store(true);
+  return true;
+}
+
+void PTYHandler::stopRecording() {
+  std::lock_guard<std::mutex> lock(recorderMutex);
+  recording.store(false);
+  recorder.close();
+}
+
+void PTYHandler::recordOutput(const char *first, size_t firstLen,
+                              const char *second, size_t size) {
+  if (!recording.load())
+    return;
+
+  // A read that wrapped the ring is still recorded as one chunk
+  std::lock_guard<std::mutex> lock(recorderMutex);
+  if (size <= firstLen) {
+    recorder.record(std::string_view(first, size));
+  } else {
+    std::string joined(first, firstLen);
+    joined.append(second, size - firstLen);
+    recorder.record(joined);
+  }
 }
 
 void PTYHandler::setWindowSize(int rows, int cols) {
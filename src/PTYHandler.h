@@ -1,9 +1,17 @@
 #pragma once
 
-#include "config.h"
+#include "RingBuffer.h"
+#include "SessionRecording.h"
+#include <atomic>
 #include <fcntl.h>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <termios.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #ifdef __APPLE__
 #include <util.h>
@@ -17,9 +25,29 @@ public:
   ~PTYHandler();
 
   bool spawnShell();
-  std::string readOutput();
+  // Drains whatever the reader thread has buffered so far (never blocks).
+  // Output is copied into the caller's reusable buffer, which only grows, and
+  // the returned view points into it. Embedded NUL bytes are preserved.
+  std::string_view readOutput(std::vector<char> &buffer);
+
+  // Called on the reader thread whenever new output lands in the ring.
+  // Must be thread-safe (e.g. glfwPostEmptyEvent). Set before spawnShell().
+  void setOutputCallback(std::function<void()> callback);
+
+  // Input is never dropped: whatever the kernel won't take right away is
+  // queued and drained by the reader thread when the fd becomes writable.
   void writeInput(const char *input, size_t size);
-  void writeInput(std::string input);
+  void writeInput(std::string_view input);
+  // Pastes text, wrapped in ESC[200~ ... ESC[201~ when the application has
+  // enabled bracketed paste mode.
+  void pasteInput(std::string_view text, bool bracketed);
+  // Bytes queued but not yet accepted by the PTY
+  size_t getPendingInput() const;
+
+  // Session recording: every chunk the reader thread pulls off the PTY is
+  // appended with its arrival time (see SessionRecording.h)
+  bool startRecording(const std::string &path);
+  void stopRecording();
 
   // Set terminal size for the PTY
   void setWindowSize(int rows, int cols);
@@ -27,4 +55,33 @@ public:
 private:
   int masterFd;
   pid_t pid;
+
+  // Reader thread: blocks in poll() on masterFd and pushes raw bytes into
+  // outputRing so the shell never waits on the render loop. It also drains
+  // the input queue whenever the fd reports POLLOUT.
+  static constexpr size_t OUTPUT_RING_SIZE = 1 << 20; // 1 MB
+  SpscRingBuffer outputRing{OUTPUT_RING_SIZE};
+  std::thread readerThread;
+  std::atomic<bool> readerRunning{false};
+  std::atomic<bool> readerWaitingForSpace{false};
+  int wakePipe[2] = {-1, -1}; // Written to stop the reader or wake it up
+  std::function<void()> outputCallback;
+
+  // Outbound queue; inputQueueOffset is the first byte not yet written
+  std::mutex inputMutex;
+  std::vector<char> inputQueue;
+  size_t inputQueueOffset = 0;
+  std::atomic<size_t> pendingInputBytes{0};
+
+  std::mutex recorderMutex;
+  SessionRecorder recorder;
+  std::atomic<bool> recording{false};
+  void recordOutput(const char *first, size_t firstLen, const char *second,
+                    size_t size);
+
+  void startReader();
+  void stopReader();
+  void readerLoop();
+  void wakeReader();
+  void flushInputLocked(); // Requires inputMutex
 };
@@ -1,18 +1,33 @@
 #pragma once
 
 #include "Shader.h"
+#include "StreamBuffer.h"
 #include "config.h"
 
 // Forward declaration if possible, but FontManager is needed in drawText header
 class FontManager;
+class GridRenderer;
+class RowCache;
+class Terminal;
+struct Character;
+
+// One vertex of a glyph or rect quad. Color travels with the vertex, so a
+// batch of any number of colors is a single draw call.
+struct Vertex {
+  float x, y; // Screen position
+  float u, v; // Atlas coordinates
+  uint8_t r, g, b;
+  uint8_t layer; // Atlas array layer (see FontManager)
+};
 
 class Renderer {
 public:
   Renderer(Shader &shader);
   ~Renderer();
 
-  // Batching methods
-  void begin();
+  // Batching methods. Glyphs and rects share one batch on the font's
+  // atlas; rects sample its white pixel. Starts the font's frame too.
+  void begin(FontManager &fontManager);
   void end();
 
   void drawText(FontManager &fontManager, std::string text, float x, float y,
@@ -20,19 +35,64 @@ public:
   void drawCodepoint(FontManager &fontManager, unsigned int codepoint, float x,
                      float y, float scale, glm::vec3 color);
   void drawRect(float x, float y, float w, float h, glm::vec3 color);
+  // Retained per-row geometry (see RowCache), drawn with the atlas texture
+  void drawRows(RowCache &rows, FontManager &fontManager);
+  // Instanced grid (see GridRenderer), after the pending batch
+  void drawGrid(GridRenderer &grid, const Terminal &terminal,
+                FontManager &fontManager, float cellWidth, float originX,
+                float originY);
+
+  // Appends the 6 vertices of a glyph quad with its origin at x, y; nothing
+  // for glyphs without a bitmap (spaces)
+  static void appendGlyphQuad(std::vector<Vertex> &out, const Character &ch,
+                              float x, float y, float scale, glm::vec3 color);
+  // Appends the 6 vertices of a solid rect; uv is the atlas white pixel
+  static void appendRectQuad(std::vector<Vertex> &out, float x, float y,
+                             float w, float h, glm::vec3 color, glm::vec2 uv);
+  // Attribute layout of Vertex for the currently bound VAO and VBO
+  static void setVertexAttributes();
+
+  // Vertex upload counters for the last finished frame
+  const StreamBuffer::Stats &getUploadStats() const {
+    return stream.getStats();
+  }
+  size_t getBatchCapacity() const { return batchQuads; }
 
 private:
   Shader &shader;
-  unsigned int VAO, VBO;
-  unsigned int whiteTexture;
-
-  // Batching
-  std::vector<float> vertices;
-  const unsigned int MAX_QUADS = 10000;
+  unsigned int VAO;
+  // The current font (set by begin); its atlas texture can change
+  // mid-frame when layers are added, so it is read at draw time
+  FontManager *font = nullptr;
+  glm::vec2 whiteUV{0.0f};
 
-  // Batch State
-  glm::vec3 batchColor = glm::vec3(-1.0f);
-  unsigned int batchTexture = 0;
+  // Batching. A batch holds at most batchQuads quads and is flushed when
+  // full; end() resizes batchQuads to the frame's peak demand, so the
+  // stream regions (one batch each) track what the window actually needs.
+  std::vector<Vertex> vertices;
+  static constexpr size_t MIN_BATCH_QUADS = 1024;
+  static constexpr size_t MAX_BATCH_QUADS = 1 << 17;
+  // Frames of low demand before the batch shrinks
+  static constexpr int SHRINK_FRAMES = 300;
+  size_t batchQuads = MIN_BATCH_QUADS;
+  // Quads queued since the last flush that was not for capacity, and the
+  // largest such run this frame
+  size_t runQuads = 0;
+  size_t peakQuads = 0;
+  int lowDemandFrames = 0;
+  StreamBuffer stream;
 
   void initRenderData();
+  // Draws and empties the pending batch
+  void flush();
+  // flush() without ending the run: the batch only split for lack of room
+  void flushFull();
+  void drawGlyph(const Character &ch, float x, float y, float scale,
+                 glm::vec3 color);
+  // Makes room in the batch for one quad
+  void prepareQuad();
+  // Grows or shrinks batchQuads after a frame
+  void fitBatch();
+  // Streams vertices and draws them as triangles
+  void drawVertices(const Vertex *data, size_t count);
 };
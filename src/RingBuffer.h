@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Fixed-capacity single-producer/single-consumer byte ring.
+// Exactly one thread may call write() and exactly one other thread may call
+// read(). No locks: head is only stored by the producer, tail only by the
+// consumer.
+class SpscRingBuffer {
+public:
+  explicit SpscRingBuffer(size_t minCapacity) {
+    // Round up to a power of two so wrapping is a mask
+    size_t cap = 1;
+    while (cap < minCapacity)
+      cap <<= 1;
+    buffer.resize(cap);
+    mask = cap - 1;
+  }
+
+  size_t capacity() const { return buffer.size(); }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) -
+           tail.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  size_t freeSpace() const { return capacity() - size(); }
+
+  // Producer side. Copies up to `size` bytes, returns how many fit.
+  size_t write(const char *data, size_t size) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t space = capacity() - (h - t);
+    if (size > space)
+      size = space;
+    if (size == 0)
+      return 0;
+
+    size_t start = h & mask;
+    size_t first = capacity() - start;
+    if (first > size)
+      first = size;
+    memcpy(buffer.data() + start, data, first);
+    memcpy(buffer.data(), data + first, size - first);
+
+    head.store(h + size, std::memory_order_release);
+    return size;
+  }
+
+  // Producer side, zero-copy: exposes the free space as up to two
+  // contiguous regions (the second one is non-empty when it wraps) so the
+  // caller can read() straight into the ring, then publish with
+  // commitWrite().
+  size_t writeRegions(char *&first, size_t &firstLen, char *&second,
+                      size_t &secondLen) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t space = capacity() - (h - t);
+
+    size_t start = h & mask;
+    firstLen = capacity() - start;
+    if (firstLen > space)
+      firstLen = space;
+    first = buffer.data() + start;
+    second = buffer.data();
+    secondLen = space - firstLen;
+    return space;
+  }
+
+  void commitWrite(size_t size) {
+    head.store(head.load(std::memory_order_relaxed) + size,
+               std::memory_order_release);
+  }
+
+  // Consumer side. Copies up to `size` bytes out, returns how many were read.
+  size_t read(char *data, size_t size) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    size_t available = h - t;
+    if (size > available)
+      size = available;
+    if (size == 0)
+      return 0;
+
+    size_t start = t & mask;
+    size_t first = capacity() - start;
+    if (first > size)
+      first = size;
+    memcpy(data, buffer.data() + start, first);
+    memcpy(data + first, buffer.data(), size - first);
+
+    tail.store(t + size, std::memory_order_release);
+    return size;
+  }
+
+private:
+  std::vector<char> buffer;
+  size_t mask;
+
+  // Monotonic positions; keep them on separate cache lines so the two
+  // threads don't false-share.
+  alignas(64) std::atomic<size_t> head{0}; // Next byte to write (producer)
+  alignas(64) std::atomic<size_t> tail{0}; // Next byte to read (consumer)
+};
@@ -0,0 +1,73 @@
+#include "RowCache.h"
+#include "Shader.h"
+#include <algorithm>
+
+RowCache::RowCache() {
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &VBO);
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  Renderer::setVertexAttributes();
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+RowCache::~RowCache() {
+  glDeleteVertexArrays(1, &VAO);
+  glDeleteBuffers(1, &VBO);
+}
+
+void RowCache::reset(size_t rowCount, size_t quadsPerRow) {
+  rows.assign(rowCount, Row());
+  slotVertices = quadsPerRow * 6;
+
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, rowCount * slotVertices * sizeof(Vertex), NULL,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RowCache::upload(size_t row, const std::vector<Vertex> *layers) {
+  staging.clear();
+  for (int layer = 0; layer < LAYERS; layer++) {
+    size_t count =
+        std::min(layers[layer].size(), slotVertices - staging.size());
+    rows[row].vertexCount[layer] = (int)count;
+    staging.insert(staging.end(), layers[layer].begin(),
+                   layers[layer].begin() + count);
+  }
+  if (staging.empty())
+    return;
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferSubData(GL_ARRAY_BUFFER, row * slotVertices * sizeof(Vertex),
+                  staging.size() * sizeof(Vertex), staging.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RowCache::draw(Shader &shader, unsigned int texture) {
+  firsts.clear();
+  counts.clear();
+  // Layer by layer, so no row's background covers another row's glyphs
+  for (int layer = 0; layer < LAYERS; layer++) {
+    for (size_t row = 0; row < rows.size(); row++) {
+      const int *count = rows[row].vertexCount;
+      if (count[layer] == 0)
+        continue;
+      int offset = 0;
+      for (int before = 0; before < layer; before++)
+        offset += count[before];
+      firsts.push_back((GLint)(row * slotVertices) + offset);
+      counts.push_back(count[layer]);
+    }
+  }
+  if (firsts.empty())
+    return;
+
+  shader.use();
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glBindVertexArray(VAO);
+  glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(),
+                    (GLsizei)firsts.size());
+  glBindVertexArray(0);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Renderer.h"
+#include "config.h"
+
+class Shader;
+
+// Retained geometry for the terminal screen: one fixed-size slot per
+// screen row in a persistent VBO, holding the row's cell backgrounds,
+// glyphs and decorations (rects sample the atlas's white pixel). A slot is
+// rewritten only when its row is damaged (see Terminal::collectDamage) or
+// the layout changes, so a static screen uploads nothing. draw() is a
+// single glMultiDrawArrays: every row's backgrounds, then every row's
+// glyphs, then the decorations.
+class RowCache {
+public:
+  // Layers of a slot, in slot order
+  enum Layer { BACKGROUNDS, GLYPHS, DECORATIONS, LAYERS };
+
+  struct Row {
+    int vertexCount[LAYERS] = {}; // Vertices of each layer in the slot
+    // Left edge of each cell, then the end of the line (cursor placement)
+    std::vector<float> cellX;
+  };
+
+  RowCache();
+  ~RowCache();
+  RowCache(const RowCache &) = delete;
+  RowCache &operator=(const RowCache &) = delete;
+
+  // Forgets every row and sizes the buffer for rows x quadsPerRow quads
+  // (all layers together)
+  void reset(size_t rows, size_t quadsPerRow);
+  size_t size() const { return rows.size(); }
+  Row &getRow(size_t row) { return rows[row]; }
+
+  // Replaces a row's vertices (6 per quad), one vector per Layer, and sets
+  // its vertex counts. Quads beyond the slot are dropped.
+  void upload(size_t row, const std::vector<Vertex> *layers);
+  void draw(Shader &shader, unsigned int texture);
+
+private:
+  unsigned int VAO = 0, VBO = 0;
+  size_t slotVertices = 0;
+  std::vector<Row> rows;
+  std::vector<Vertex> staging; // A slot's layers, concatenated
+
+  // Per-frame multi-draw lists, kept to avoid reallocating
+  std::vector<GLint> firsts;
+  std::vector<GLsizei> counts;
+};
@@ -0,0 +1,398 @@
+#include "Scrollback.h"
+#include "Lz4.h"
+#include "Utf8Decoder.h"
+#include <algorithm>
+
+static void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    if (value)
+      byte |= 0x80;
+    out.push_back(byte);
+  } while (value);
+}
+
+static bool readVarint(const uint8_t *&p, const uint8_t *end,
+                       uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p >= end)
+      return false;
+    uint8_t byte = *p++;
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static bool sameStyle(const Cell &a, const Cell &b) {
+  return a.attributes == b.attributes && a.fg == b.fg && a.bg == b.bg;
+}
+
+static void writeU16(std::vector<uint8_t> &out, uint16_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+Scrollback::~Scrollback() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  if (worker.joinable())
+    worker.join();
+}
+
+void Scrollback::pushPage(std::vector<Cell> cells,
+                          std::vector<LineInfo> lines) {
+  if (lines.empty())
+    return;
+
+  auto page = std::make_shared<Page>();
+  page->start = firstLine + lineCount;
+  page->lineCount = lines.size();
+  page->cellCount = cells.size();
+  page->raw = std::move(cells);
+  page->rawLines = std::move(lines);
+  lineCount += page->lineCount;
+  pages.push_back(page);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(page);
+  }
+  if (!worker.joinable())
+    worker = std::thread(&Scrollback::workerLoop, this);
+  wake.notify_one();
+}
+
+void Scrollback::dropOldest(size_t count) {
+  count = std::min(count, lineCount);
+  firstLine += count;
+  lineCount -= count;
+  auto expired = [&]() {
+    return !pages.empty() &&
+           pages.front()->start + pages.front()->lineCount <= firstLine;
+  };
+  // Most calls drop a line from the middle of a page: no locking needed
+  if (!expired())
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  while (expired()) {
+    Page &page = *pages.front();
+    page.dropped = true;
+    if (page.spilled)
+      spill.release(page.spillOffset, page.spillSize);
+    pages.pop_front();
+  }
+  while (!resident.empty() && resident.front()->dropped) {
+    residentBytes -= resident.front()->packed.size();
+    resident.pop_front();
+  }
+}
+
+void Scrollback::clear() {
+  dropOldest(lineCount);
+  cache.clear();
+}
+
+bool Scrollback::enableSpill(size_t residentBytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!spill.isOpen() && !spill.open())
+    return false;
+  spillBudget = residentBytes;
+
+  // Pages packed so far; the worker adds the rest as it packs them
+  resident.clear();
+  residentBytes = 0;
+  for (const auto &page : pages) {
+    if (page->spilled || page->packed.empty())
+      continue;
+    resident.push_back(page);
+    this->residentBytes += page->packed.size();
+  }
+  wake.notify_one();
+  return true;
+}
+
+const std::shared_ptr<Scrollback::Page> &
+Scrollback::pageFor(size_t line, size_t &index) const {
+  uint64_t absolute = firstLine + line;
+  // Last page starting at or before the line
+  auto it = std::upper_bound(
+      pages.begin(), pages.end(), absolute,
+      [](uint64_t value, const std::shared_ptr<Page> &page) {
+        return value < page->start;
+      });
+  --it;
+  index = (size_t)(absolute - (*it)->start);
+  return *it;
+}
+
+Scrollback::LineInfo Scrollback::getLineInfo(size_t line) const {
+  size_t index;
+  return load(pageFor(line, index)).lines[index];
+}
+
+const Cell *Scrollback::getLine(size_t line, LineInfo &info) const {
+  size_t index;
+  const CachedPage &cached = load(pageFor(line, index));
+  info = cached.lines[index];
+  return cached.cells.data() + cached.lineOffsets[index];
+}
+
+const Scrollback::CachedPage &
+Scrollback::load(const std::shared_ptr<Page> &page) const {
+  useClock++;
+  for (auto &entry : cache) {
+    if (entry.page == page) {
+      entry.lastUse = useClock;
+      return entry;
+    }
+  }
+
+  // Miss: reuse the least recently used slot once the cache is full
+  CachedPage *slot;
+  if (cache.size() < CACHE_PAGES) {
+    cache.emplace_back();
+    slot = &cache.back();
+  } else {
+    slot = &*std::min_element(cache.begin(), cache.end(),
+                              [](const CachedPage &a, const CachedPage &b) {
+                                return a.lastUse < b.lastUse;
+                              });
+  }
+  slot->page = page;
+  slot->lastUse = useClock;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (page->spilled) {
+      const uint8_t *data = spill.read(page->spillOffset, page->spillSize);
+      unpack(*page, data, data ? page->spillSize : 0, *slot);
+    } else if (!page->packed.empty()) {
+      unpack(*page, page->packed.data(), page->packed.size(), *slot);
+    } else {
+      // Not compressed yet
+      slot->cells = page->raw;
+      slot->lines = page->rawLines;
+    }
+  }
+
+  slot->lineOffsets.resize(page->lineCount);
+  uint32_t offset = 0;
+  for (size_t i = 0; i < page->lineCount; i++) {
+    slot->lineOffsets[i] = offset;
+    offset += slot->lines[i].length;
+  }
+  return *slot;
+}
+
+Scrollback::Stats Scrollback::getStats() const {
+  Stats stats;
+  stats.lines = lineCount;
+  stats.pages = pages.size();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &page : pages) {
+    stats.compressedBytes += sizeof(Page) + page->packed.capacity();
+    stats.pendingBytes += page->raw.capacity() * sizeof(Cell) +
+                          page->rawLines.capacity() * sizeof(LineInfo);
+    if (page->spilled) {
+      stats.spilledBytes += page->spillSize;
+      stats.spilledPages++;
+    }
+  }
+  for (const auto &entry : cache) {
+    stats.cacheBytes += entry.cells.capacity() * sizeof(Cell) +
+                        entry.lines.capacity() * sizeof(LineInfo) +
+                        entry.lineOffsets.capacity() * sizeof(uint32_t);
+  }
+  return stats;
+}
+
+void Scrollback::waitForCompression() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [&]() {
+    return queue.empty() && !compressing && residentBytes <= spillBudget;
+  });
+}
+
+void Scrollback::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [&]() {
+      return stopping || !queue.empty() || residentBytes > spillBudget;
+    });
+    if (stopping)
+      return;
+    compressing = true;
+
+    if (!queue.empty()) {
+      std::shared_ptr<Page> page = queue.front();
+      queue.pop_front();
+
+      // raw is immutable until the swap below, so it can be read unlocked
+      lock.unlock();
+      std::vector<uint8_t> packed = pack(*page);
+      lock.lock();
+
+      page->packed = std::move(packed);
+      page->raw = std::vector<Cell>();
+      page->rawLines = std::vector<LineInfo>();
+      if (spill.isOpen() && !page->dropped) {
+        resident.push_back(page);
+        residentBytes += page->packed.size();
+      }
+    }
+    spillOverBudget(lock);
+
+    compressing = false;
+    if (queue.empty())
+      idle.notify_all();
+  }
+}
+
+void Scrollback::spillOverBudget(std::unique_lock<std::mutex> &lock) {
+  while (residentBytes > spillBudget && !resident.empty()) {
+    std::shared_ptr<Page> page = resident.front();
+    resident.pop_front();
+    residentBytes -= page->packed.size();
+    if (page->dropped)
+      continue;
+
+    // packed is only replaced by this thread, so it can be read unlocked
+    lock.unlock();
+    uint64_t offset;
+    bool written = spill.append(page->packed.data(), page->packed.size(),
+                                offset);
+    lock.lock();
+
+    if (!written) {
+      // Disk full or similar: keep the rest of the history in RAM
+      spillBudget = SIZE_MAX;
+      resident.clear();
+      residentBytes = 0;
+      return;
+    }
+    page->spilled = true;
+    page->spillOffset = offset;
+    page->spillSize = page->packed.size();
+    page->packed = std::vector<uint8_t>();
+    if (page->dropped)
+      spill.release(page->spillOffset, page->spillSize);
+  }
+}
+
+// Packed page layout:
+//   varint  per line: length << 1 | wrapped
+//   varint  UTF-8 size, varint LZ4 size, LZ4 block of the UTF-8 codepoints
+//   varint  style run count, then per run: varint length, u16 attributes,
+//           u16 fg, u16 bg
+std::vector<uint8_t> Scrollback::pack(const Page &page) {
+  const std::vector<Cell> &cells = page.raw;
+  std::vector<uint8_t> runs;
+  size_t runCount = 0;
+
+  // Worst case 4 bytes per cell; trimmed below
+  std::vector<uint8_t> utf8(cells.size() * 4);
+  char *out = (char *)utf8.data();
+  for (size_t i = 0; i < cells.size();) {
+    // One style run per pass; its text is encoded on the way
+    const Cell &style = cells[i];
+    size_t runEnd = i;
+    do {
+      uint32_t c = cells[runEnd].codepoint;
+      if (c < 0x80)
+        *out++ = (char)c;
+      else
+        out += encodeUtf8(c, out);
+      runEnd++;
+    } while (runEnd < cells.size() && sameStyle(cells[runEnd], style));
+
+    writeVarint(runs, runEnd - i);
+    writeU16(runs, style.attributes);
+    writeU16(runs, style.fg);
+    writeU16(runs, style.bg);
+    runCount++;
+    i = runEnd;
+  }
+  utf8.resize(out - (char *)utf8.data());
+
+  std::vector<uint8_t> compressed(lz4CompressBound(utf8.size()));
+  compressed.resize(lz4Compress(utf8.data(), utf8.size(), compressed.data()));
+
+  std::vector<uint8_t> packed;
+  for (const LineInfo &line : page.rawLines)
+    writeVarint(packed, (uint64_t)line.length << 1 | line.wrapped);
+  writeVarint(packed, utf8.size());
+  writeVarint(packed, compressed.size());
+  packed.insert(packed.end(), compressed.begin(), compressed.end());
+  writeVarint(packed, runCount);
+  packed.insert(packed.end(), runs.begin(), runs.end());
+  packed.shrink_to_fit();
+  return packed;
+}
+
+void Scrollback::unpack(const Page &page, const uint8_t *data, size_t size,
+                        CachedPage &out) {
+  // Anything inconsistent leaves blanks rather than garbage
+  std::vector<Cell> &cells = out.cells;
+  cells.assign(page.cellCount, Cell{' ', 0, COLOR_DEFAULT_FG, COLOR_DEFAULT_BG});
+  out.lines.assign(page.lineCount, LineInfo());
+
+  const uint8_t *p = data;
+  const uint8_t *end = data + size;
+  size_t lineCells = 0;
+  for (LineInfo &line : out.lines) {
+    uint64_t value;
+    if (!readVarint(p, end, value))
+      break;
+    line.length = (uint16_t)(value >> 1);
+    line.wrapped = value & 1;
+    lineCells += line.length;
+  }
+  if (lineCells != page.cellCount) {
+    out.lines.assign(page.lineCount, LineInfo());
+    return;
+  }
+
+  uint64_t utf8Size, compressedSize;
+  if (!readVarint(p, end, utf8Size) || !readVarint(p, end, compressedSize) ||
+      compressedSize > (uint64_t)(end - p) || utf8Size > page.cellCount * 4)
+    return;
+
+  std::vector<uint8_t> utf8(utf8Size);
+  if (!lz4Decompress(p, compressedSize, utf8.data(), utf8.size()))
+    return;
+  p += compressedSize;
+
+  std::vector<uint32_t> codepoints(utf8.size() + 1);
+  Utf8Decoder decoder;
+  size_t count = decoder.decode(utf8.data(), utf8.size(), codepoints.data());
+  for (size_t i = 0; i < count && i < cells.size(); i++)
+    cells[i].codepoint = codepoints[i];
+
+  uint64_t runCount;
+  if (!readVarint(p, end, runCount))
+    return;
+  size_t cell = 0;
+  for (uint64_t run = 0; run < runCount; run++) {
+    uint64_t length;
+    if (!readVarint(p, end, length) || end - p < 6)
+      return;
+    uint16_t attributes = p[0] | p[1] << 8;
+    uint16_t fg = p[2] | p[3] << 8;
+    uint16_t bg = p[4] | p[5] << 8;
+    p += 6;
+    for (uint64_t i = 0; i < length && cell < cells.size(); i++, cell++) {
+      cells[cell].attributes = attributes;
+      cells[cell].fg = fg;
+      cells[cell].bg = bg;
+    }
+  }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Cell.h"
+#include "SpillFile.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Compressed history behind a Grid. Lines that leave the Grid's hot ring
+// arrive here a page (normally PAGE_LINES lines) at a time and are
+// compressed on a background thread:
+//   line table  varint lengths and wrap flags
+//   codepoints  UTF-8 encoded, then LZ4 (see Lz4.h)
+//   styles      run-length encoded (attributes, fg, bg) runs
+// Reads decompress whole pages on demand into a small LRU cache, so scrolling
+// through history only pays for the pages on screen.
+//
+// With enableSpill(), packed pages beyond a RAM budget are moved to a
+// SpillFile, oldest first, and mapped back in when read. RAM use is then
+// the budget plus about 200 bytes of bookkeeping per page.
+class Scrollback {
+public:
+  static constexpr size_t PAGE_LINES = 256;
+  static constexpr size_t CACHE_PAGES = 4;
+
+  struct LineInfo {
+    uint16_t length = 0;
+    bool wrapped = false;
+  };
+
+  struct Stats {
+    size_t lines = 0;
+    size_t pages = 0;
+    size_t compressedBytes = 0; // Packed pages held in RAM
+    size_t pendingBytes = 0;    // Pages still waiting for the worker
+    size_t cacheBytes = 0;      // Decompressed pages in the LRU
+    size_t spilledBytes = 0;    // Packed pages in the spill file (not RAM)
+    size_t spilledPages = 0;
+    // RAM only
+    size_t total() const { return compressedBytes + pendingBytes + cacheBytes; }
+  };
+
+  Scrollback() = default;
+  ~Scrollback();
+  Scrollback(const Scrollback &) = delete;
+  Scrollback &operator=(const Scrollback &) = delete;
+
+  size_t size() const { return lineCount; }
+
+  // Appends lines.size() lines whose used cells are packed back to back in
+  // cells, oldest first
+  void pushPage(std::vector<Cell> cells, std::vector<LineInfo> lines);
+  // Forgets the oldest count lines
+  void dropOldest(size_t count);
+  void clear();
+
+  // Keeps at most residentBytes of packed pages in RAM and spills older ones
+  // to a temporary file. Returns false (and keeps everything in RAM) if the
+  // file can't be created.
+  bool enableSpill(size_t residentBytes);
+
+  // Cells of a line (info.length of them). The pointer stays valid until
+  // the next getLine call that has to load a different page.
+  const Cell *getLine(size_t line, LineInfo &info) const;
+  LineInfo getLineInfo(size_t line) const;
+
+  Stats getStats() const;
+  // Blocks until every page handed over so far is compressed (and spilled,
+  // if over budget)
+  void waitForCompression() const;
+
+private:
+  struct Page {
+    uint64_t start = 0; // Absolute number of the first line
+    size_t lineCount = 0;
+    size_t cellCount = 0;
+    // Cells and lines until the worker has compressed them, then the packed
+    // form, then (when spilled) only its place in the spill file
+    std::vector<Cell> raw;
+    std::vector<LineInfo> rawLines;
+    std::vector<uint8_t> packed;
+    bool spilled = false;
+    uint64_t spillOffset = 0;
+    size_t spillSize = 0;
+    bool dropped = false; // Dropped while the worker still held it
+  };
+
+  struct CachedPage {
+    std::shared_ptr<const Page> page;
+    std::vector<Cell> cells;
+    std::vector<LineInfo> lines;
+    std::vector<uint32_t> lineOffsets;
+    uint64_t lastUse = 0;
+  };
+
+  // Absolute number of logical line 0; grows as old lines are dropped
+  uint64_t firstLine = 0;
+  size_t lineCount = 0;
+  std::deque<std::shared_ptr<Page>> pages;
+
+  mutable std::vector<CachedPage> cache;
+  mutable uint64_t useClock = 0;
+
+  // Background compression. The mutex guards the queue, the spill state and
+  // the raw/packed/spilled fields of each Page; everything else is only
+  // touched by the owner thread.
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  mutable std::condition_variable idle;
+  std::deque<std::shared_ptr<Page>> queue;
+  bool compressing = false;
+  bool stopping = false;
+  std::thread worker;
+
+  // Packed pages in RAM, oldest first, while spilling is enabled
+  mutable SpillFile spill;
+  size_t spillBudget = SIZE_MAX;
+  std::deque<std::shared_ptr<Page>> resident;
+  size_t residentBytes = 0;
+
+  const std::shared_ptr<Page> &pageFor(size_t line, size_t &index) const;
+  const CachedPage &load(const std::shared_ptr<Page> &page) const;
+  void workerLoop();
+  // Worker side: moves the oldest resident pages to the spill file until
+  // the budget holds. Called and returns with the lock held.
+  void spillOverBudget(std::unique_lock<std::mutex> &lock);
+
+  static std::vector<uint8_t> pack(const Page &page);
+  static void unpack(const Page &page, const uint8_t *data, size_t size,
+                     CachedPage &out);
+};
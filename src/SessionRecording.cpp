@@ -0,0 +1,123 @@
+#include "SessionRecording.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+static const char RECORDING_MAGIC[] = "TGLREC1\n";
+static const size_t RECORDING_MAGIC_SIZE = sizeof(RECORDING_MAGIC) - 1;
+
+static uint64_t nowMicroseconds() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+SessionRecorder::~SessionRecorder() { close(); }
+
+bool SessionRecorder::open(const std::string &path) {
+  close();
+  file = fopen(path.c_str(), "wb");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+  fwrite(RECORDING_MAGIC, 1, RECORDING_MAGIC_SIZE, file);
+  startUs = nowMicroseconds();
+  lastUs = 0;
+  return true;
+}
+
+void SessionRecorder::close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+void SessionRecorder::record(std::string_view data) {
+  record(data, nowMicroseconds() - startUs);
+}
+
+void SessionRecorder::record(std::string_view data, uint64_t timestampUs) {
+  if (!file || data.empty())
+    return;
+
+  // Timestamps are stored as deltas so they stay one or two bytes long
+  if (timestampUs < lastUs)
+    timestampUs = lastUs;
+  writeVarint(timestampUs - lastUs);
+  writeVarint(data.size());
+  fwrite(data.data(), 1, data.size(), file);
+  lastUs = timestampUs;
+}
+
+void SessionRecorder::writeVarint(uint64_t value) {
+  unsigned char bytes[10];
+  int count = 0;
+  do {
+    unsigned char byte = value & 0x7F;
+    value >>= 7;
+    if (value)
+      byte |= 0x80;
+    bytes[count++] = byte;
+  } while (value);
+  fwrite(bytes, 1, count, file);
+}
+
+static bool readVarint(const std::vector<char> &data, size_t &pos,
+                       uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= data.size())
+      return false;
+    unsigned char byte = (unsigned char)data[pos++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool SessionReplay::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open recording: " << path << std::endl;
+    return false;
+  }
+  std::streamsize size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  storage.resize(size);
+  if (!file.read(storage.data(), size)) {
+    std::cerr << "Failed to read recording: " << path << std::endl;
+    return false;
+  }
+
+  if (storage.size() < RECORDING_MAGIC_SIZE ||
+      std::string_view(storage.data(), RECORDING_MAGIC_SIZE) !=
+          RECORDING_MAGIC) {
+    std::cerr << "Not a session recording: " << path << std::endl;
+    return false;
+  }
+
+  chunks.clear();
+  totalBytes = 0;
+  uint64_t timestampUs = 0;
+  size_t pos = RECORDING_MAGIC_SIZE;
+  while (pos < storage.size()) {
+    uint64_t delta, length;
+    if (!readVarint(storage, pos, delta) || !readVarint(storage, pos, length) ||
+        length > storage.size() - pos) {
+      // Truncated tail (e.g. the terminal was killed mid-write): keep what
+      // we have
+      std::cerr << "Recording truncated after " << chunks.size() << " chunks"
+                << std::endl;
+      break;
+    }
+    timestampUs += delta;
+    chunks.push_back({timestampUs, std::string_view(storage.data() + pos,
+                                                    (size_t)length)});
+    totalBytes += length;
+    pos += length;
+  }
+  return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Recorded PTY session file format:
+//   "TGLREC1\n" magic, then one record per output chunk:
+//   varint  microseconds since the previous chunk (since start for the first)
+//   varint  chunk length in bytes
+//   bytes   raw PTY output, unmodified
+// Varints are LEB128 (7 bits per byte, high bit = more bytes follow).
+
+class SessionRecorder {
+public:
+  SessionRecorder() = default;
+  ~SessionRecorder();
+  SessionRecorder(const SessionRecorder &) = delete;
+  SessionRecorder &operator=(const SessionRecorder &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const { return file != nullptr; }
+
+  // Appends one chunk stamped with the current time
+  void record(std::string_view data);
+  // Appends one chunk with an explicit timestamp (microseconds since start)
+  void record(std::string_view data, uint64_t timestampUs);
+
+private:
+  FILE *file = nullptr;
+  uint64_t startUs = 0;
+  uint64_t lastUs = 0;
+
+  void writeVarint(uint64_t value);
+};
+
+struct RecordedChunk {
+  uint64_t timestampUs; // Since the start of the recording
+  std::string_view data; // Points into SessionReplay's storage
+};
+
+class SessionReplay {
+public:
+  // Loads and indexes the whole file so playback measures parsing only
+  bool load(const std::string &path);
+
+  const std::vector<RecordedChunk> &getChunks() const { return chunks; }
+  size_t getTotalBytes() const { return totalBytes; }
+
+private:
+  std::vector<char> storage;
+  std::vector<RecordedChunk> chunks;
+  size_t totalBytes = 0;
+};
@@ -1,11 +1,22 @@
 #pragma once
 
+#include "ShaderCache.h"
 #include "config.h"
+#include <chrono>
+#include <unordered_map>
 
 class Shader {
 public:
   unsigned int ID;
 
+  // Binding point of the shared `Frame` uniform block (see FrameUniforms)
+  static constexpr unsigned int FRAME_BLOCK_BINDING = 0;
+
+  // Typed handle to a uniform location, resolved once with uniform<T>()
+  template <typename T> struct Uniform {
+    GLint location = -1;
+  };
+
   Shader(const char *vertexPath, const char *fragmentPath,
          bool isRawSource = false) {
     std::string vertexCode;
@@ -41,6 +52,75 @@ public:
       }
     }
 
+    auto start = std::chrono::steady_clock::now();
+    ID = glCreateProgram();
+    bool cached = ShaderCache::load(ID, vertexCode, fragmentCode);
+    if (!cached)
+      build(vertexCode, fragmentCode);
+    cacheUniforms();
+    ShaderCache::record(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count(),
+                        cached);
+  }
+
+  // activate the shader
+  // ------------------------------------------------------------------------
+  void use() { glUseProgram(ID); }
+
+  // Location cached at link time; -1 (ignored by glUniform*) if the
+  // program has no such active uniform
+  GLint location(const std::string &name) const {
+    auto it = locations.find(name);
+    return it == locations.end() ? -1 : it->second;
+  }
+  template <typename T> Uniform<T> uniform(const std::string &name) const {
+    return Uniform<T>{location(name)};
+  }
+
+  // typed uniform setters (the program must be in use)
+  // ------------------------------------------------------------------------
+  void set(Uniform<int> u, int value) const { glUniform1i(u.location, value); }
+  void set(Uniform<float> u, float value) const {
+    glUniform1f(u.location, value);
+  }
+  void set(Uniform<glm::vec2> u, glm::vec2 value) const {
+    glUniform2f(u.location, value.x, value.y);
+  }
+  void set(Uniform<glm::vec3> u, glm::vec3 value) const {
+    glUniform3f(u.location, value.x, value.y, value.z);
+  }
+  void set(Uniform<glm::mat4> u, const glm::mat4 &value) const {
+    glUniformMatrix4fv(u.location, 1, GL_FALSE, &value[0][0]);
+  }
+
+  // utility uniform functions, by name (a hash lookup, no GL query)
+  // ------------------------------------------------------------------------
+  void setBool(const std::string &name, bool value) const {
+    glUniform1i(location(name), (int)value);
+  }
+  // ... add more as needed
+  void setInt(const std::string &name, int value) const {
+    glUniform1i(location(name), value);
+  }
+  void setFloat(const std::string &name, float value) const {
+    glUniform1f(location(name), value);
+  }
+  void setVec2(const std::string &name, float x, float y) const {
+    glUniform2f(location(name), x, y);
+  }
+  void setVec3(const std::string &name, float x, float y, float z) const {
+    glUniform3f(location(name), x, y, z);
+  }
+  void setMat4(const std::string &name, const float *value) const {
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, value);
+  }
+
+private:
+  std::unordered_map<std::string, GLint> locations;
+
+  // Compiles both stages and links them into ID (the cache-miss path)
+  void build(const std::string &vertexCode, const std::string &fragmentCode) {
     const char *vShaderCode = vertexCode.c_str();
     const char *fShaderCode = fragmentCode.c_str();
 
@@ -60,11 +140,12 @@ public:
     checkCompileErrors(fragment, "FRAGMENT");
 
     // shader Program
-    ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    ShaderCache::prepare(ID);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    ShaderCache::store(ID, vertexCode, fragmentCode);
 
     // delete the shaders as they're linked into our program now and no longer
     // necessary
@@ -72,31 +153,31 @@ public:
     glDeleteShader(fragment);
   }
 
-  // activate the shader
-  // ------------------------------------------------------------------------
-  void use() { glUseProgram(ID); }
+  // Records every active uniform's location and binds the Frame block
+  void cacheUniforms() {
+    GLint count = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; i++) {
+      char name[256];
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(ID, i, sizeof(name), &length, &size, &type, name);
+      GLint loc = glGetUniformLocation(ID, name);
+      if (loc < 0)
+        continue; // Block member
+      std::string key(name, length);
+      // Arrays are reported as "name[0]"; look them up by plain name
+      if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+        key.resize(key.size() - 3);
+      locations[key] = loc;
+    }
 
-  // utility uniform functions
-  // ------------------------------------------------------------------------
-  void setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
-  }
-  // ... add more as needed
-  void setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
-  }
-  void setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-  }
-  void setVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
-  }
-  void setMat4(const std::string &name, const float *value) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       value);
+    GLuint block = glGetUniformBlockIndex(ID, "Frame");
+    if (block != GL_INVALID_INDEX)
+      glUniformBlockBinding(ID, block, FRAME_BLOCK_BINDING);
   }
 
-private:
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(unsigned int shader, std::string type) {
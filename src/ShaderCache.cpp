@@ -0,0 +1,184 @@
+#include "ShaderCache.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+// GL 4.1 / ARB_get_program_binary; the loader only covers GL 4.0
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (*GetProgramBinaryProc)(GLuint, GLsizei, GLsizei *, GLenum *,
+                                     void *);
+typedef void (*ProgramBinaryProc)(GLuint, GLenum, const void *, GLsizei);
+typedef void (*ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+static GetProgramBinaryProc getProgramBinary = nullptr;
+static ProgramBinaryProc programBinary = nullptr;
+static ProgramParameteriProc programParameteri = nullptr;
+
+// Entry header: magic, binary format, binary length
+static const uint32_t MAGIC = 0x42474c54; // "TLGB"
+
+bool ShaderCache::enabled = false;
+std::string ShaderCache::directory;
+ShaderCache::Stats ShaderCache::stats;
+
+static uint64_t fnv1a(uint64_t hash, const std::string &text) {
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  // Separator, so ("ab", "c") and ("a", "bc") differ
+  hash ^= 0xff;
+  hash *= 1099511628211ull;
+  return hash;
+}
+
+static std::string glString(GLenum name) {
+  const GLubyte *value = glGetString(name);
+  return value ? (const char *)value : "";
+}
+
+static bool makeDirectory(const std::string &path) {
+  if (mkdir(path.c_str(), 0700) == 0 || errno == EEXIST)
+    return true;
+  perror(("mkdir " + path).c_str());
+  return false;
+}
+
+bool ShaderCache::init() {
+  enabled = false;
+  const char *setting = getenv("TERMINALGL_SHADER_CACHE");
+  if (setting && atoi(setting) == 0)
+    return false;
+
+  getProgramBinary =
+      (GetProgramBinaryProc)glfwGetProcAddress("glGetProgramBinary");
+  programBinary = (ProgramBinaryProc)glfwGetProcAddress("glProgramBinary");
+  programParameteri =
+      (ProgramParameteriProc)glfwGetProcAddress("glProgramParameteri");
+  GLint formats = 0;
+  if (getProgramBinary && programBinary && programParameteri)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats <= 0)
+    return false;
+
+  // $XDG_CACHE_HOME/terminalgl, else ~/.cache/terminalgl
+  const char *cacheHome = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  std::string base;
+  if (cacheHome && *cacheHome) {
+    base = cacheHome;
+  } else if (home && *home) {
+    base = std::string(home) + "/.cache";
+    if (!makeDirectory(base))
+      return false;
+  } else {
+    return false;
+  }
+  directory = base + "/terminalgl";
+  if (!makeDirectory(directory))
+    return false;
+
+  enabled = true;
+  return true;
+}
+
+std::string ShaderCache::entryPath(const std::string &vertexCode,
+                                   const std::string &fragmentCode) {
+  uint64_t hash = 14695981039346656037ull;
+  hash = fnv1a(hash, vertexCode);
+  hash = fnv1a(hash, fragmentCode);
+  hash = fnv1a(hash, glString(GL_VENDOR));
+  hash = fnv1a(hash, glString(GL_RENDERER));
+  hash = fnv1a(hash, glString(GL_VERSION));
+
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)hash);
+  return directory + name;
+}
+
+bool ShaderCache::load(unsigned int &program, const std::string &vertexCode,
+                       const std::string &fragmentCode) {
+  if (!enabled)
+    return false;
+
+  std::string path = entryPath(vertexCode, fragmentCode);
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+
+  uint32_t header[3];
+  std::vector<char> binary;
+  bool ok = fread(header, sizeof(header), 1, file) == 1 &&
+            header[0] == MAGIC && header[2] > 0 && header[2] < (64u << 20);
+  if (ok) {
+    binary.resize(header[2]);
+    ok = fread(binary.data(), binary.size(), 1, file) == 1;
+  }
+  fclose(file);
+
+  GLint linked = 0;
+  if (ok) {
+    programBinary(program, header[1], binary.data(), (GLsizei)binary.size());
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  }
+  if (linked)
+    return true;
+
+  // Stale or corrupt: drop it and let the caller build from source
+  std::cout << "Shader cache: rebuilding " << path << std::endl;
+  remove(path.c_str());
+  glDeleteProgram(program);
+  program = glCreateProgram();
+  return false;
+}
+
+void ShaderCache::prepare(unsigned int program) {
+  if (enabled)
+    programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCache::store(unsigned int program, const std::string &vertexCode,
+                        const std::string &fragmentCode) {
+  if (!enabled)
+    return;
+  GLint linked = 0, length = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (!linked || length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  getProgramBinary(program, length, &length, &format, binary.data());
+
+  // Write then rename, so a concurrent launch never reads half a file
+  std::string path = entryPath(vertexCode, fragmentCode);
+  std::string temp = path + ".tmp";
+  FILE *file = fopen(temp.c_str(), "wb");
+  if (!file)
+    return;
+  uint32_t header[3] = {MAGIC, (uint32_t)format, (uint32_t)length};
+  bool ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+            fwrite(binary.data(), length, 1, file) == 1;
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp.c_str(), path.c_str()) != 0)
+    remove(temp.c_str());
+}
+
+void ShaderCache::record(double milliseconds, bool cacheHit) {
+  stats.programs++;
+  if (cacheHit)
+    stats.cacheHits++;
+  stats.milliseconds += milliseconds;
+}
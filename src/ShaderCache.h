@@ -0,0 +1,47 @@
+#pragma once
+
+#include "config.h"
+
+// On-disk cache of linked program binaries, so later launches skip
+// compiling and linking. Entries are keyed by a hash of the shader sources
+// and the GL vendor/renderer/version strings; a binary the driver rejects
+// (e.g. after a driver update) is deleted and the program is built from
+// source again. glGetProgramBinary is GL 4.1, so the entry points are
+// looked up at runtime and the cache stays off where they are missing.
+//
+// Set TERMINALGL_SHADER_CACHE=0 to disable it (to compare startup times).
+class ShaderCache {
+public:
+  // Timing of every program built so far (see Shader's constructor)
+  struct Stats {
+    int programs = 0;
+    int cacheHits = 0;
+    double milliseconds = 0.0; // Compile/link or binary load, in total
+  };
+
+  // Picks the cache directory and resolves the GL entry points; call once
+  // after the GL context is current. False if the cache is unavailable.
+  static bool init();
+  static bool isEnabled() { return enabled; }
+
+  // Links `program` from a cached binary; false on a miss or rejection
+  // (`program` is then recreated empty, ready for the source path)
+  static bool load(unsigned int &program, const std::string &vertexCode,
+                   const std::string &fragmentCode);
+  // Call before glLinkProgram so the driver keeps a retrievable binary
+  static void prepare(unsigned int program);
+  // Saves a freshly linked program
+  static void store(unsigned int program, const std::string &vertexCode,
+                    const std::string &fragmentCode);
+
+  static void record(double milliseconds, bool cacheHit);
+  static const Stats &getStats() { return stats; }
+
+private:
+  static bool enabled;
+  static std::string directory;
+  static Stats stats;
+
+  static std::string entryPath(const std::string &vertexCode,
+                               const std::string &fragmentCode);
+};
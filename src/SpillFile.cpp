@@ -0,0 +1,92 @@
+#include "SpillFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// The mapping grows in steps of at least this much (it may extend past the
+// end of the file; only written ranges are ever touched)
+static const size_t MIN_MAP_SIZE = 64 << 20;
+// Hole punching works on whole filesystem blocks
+static const uint64_t HOLE_ALIGNMENT = 4096;
+
+SpillFile::~SpillFile() {
+  if (map)
+    munmap(map, mapSize);
+  if (fd >= 0)
+    close(fd);
+}
+
+bool SpillFile::open() {
+  const char *directory = getenv("TMPDIR");
+  std::string path = directory && *directory ? directory : "/tmp";
+  path += "/terminalgl-scrollback-XXXXXX";
+
+  fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(path.c_str());
+  return true;
+}
+
+bool SpillFile::append(const uint8_t *data, size_t size, uint64_t &offset) {
+  offset = writeOffset;
+  size_t written = 0;
+  while (written < size) {
+    ssize_t n = pwrite(fd, data + written, size - written,
+                       (off_t)(offset + written));
+    if (n < 0) {
+      perror("pwrite");
+      return false;
+    }
+    written += (size_t)n;
+  }
+  writeOffset += size;
+  return true;
+}
+
+const uint8_t *SpillFile::read(uint64_t offset, size_t size) {
+  uint64_t end = offset + size;
+  if (end > mapSize) {
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t newSize = std::max<size_t>({(size_t)end, mapSize * 2,
+                                       MIN_MAP_SIZE});
+    newSize = (newSize + pageSize - 1) / pageSize * pageSize;
+
+    if (map)
+      munmap(map, mapSize);
+    void *mapped = mmap(nullptr, newSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      perror("mmap");
+      map = nullptr;
+      mapSize = 0;
+      return nullptr;
+    }
+    map = (uint8_t *)mapped;
+    mapSize = newSize;
+  }
+  return map + offset;
+}
+
+void SpillFile::release(uint64_t offset, size_t size) {
+  // Only the blocks entirely inside the range
+  uint64_t start = (offset + HOLE_ALIGNMENT - 1) / HOLE_ALIGNMENT *
+                   HOLE_ALIGNMENT;
+  uint64_t end = (offset + size) / HOLE_ALIGNMENT * HOLE_ALIGNMENT;
+  if (end <= start)
+    return;
+#if defined(FALLOC_FL_PUNCH_HOLE)
+  fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)start,
+            (off_t)(end - start));
+#elif defined(F_PUNCHHOLE)
+  fpunchhole_t hole = {};
+  hole.fp_offset = (off_t)start;
+  hole.fp_length = (off_t)(end - start);
+  fcntl(fd, F_PUNCHHOLE, &hole);
+#endif
+}
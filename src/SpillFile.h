@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Append-only temporary file for scrollback pages that no longer fit in RAM.
+// Data goes in with pwrite and comes back through a read-only shared mapping
+// of the file, so pages are faulted in lazily when history is scrolled to
+// and the kernel can drop them again under memory pressure.
+//
+// The file is unlinked as soon as it is created, so nothing is left behind
+// even if the process dies. Not synchronised: append() may run on one thread
+// while read()/release() run on another, but each of those must be
+// serialised by the caller.
+class SpillFile {
+public:
+  SpillFile() = default;
+  ~SpillFile();
+  SpillFile(const SpillFile &) = delete;
+  SpillFile &operator=(const SpillFile &) = delete;
+
+  // Creates the file in $TMPDIR (or /tmp). Prints the error and returns
+  // false on failure.
+  bool open();
+  bool isOpen() const { return fd >= 0; }
+
+  // Appends size bytes and returns their offset in offset
+  bool append(const uint8_t *data, size_t size, uint64_t &offset);
+  // size bytes at offset, or nullptr on error. Valid until the next read()
+  // that has to grow the mapping.
+  const uint8_t *read(uint64_t offset, size_t size);
+  // Returns the disk blocks of a dropped range to the filesystem where the
+  // platform can punch holes; elsewhere the space is reused only after the
+  // file is closed
+  void release(uint64_t offset, size_t size);
+
+private:
+  int fd = -1;
+  uint64_t writeOffset = 0; // Owned by the appending thread
+  uint8_t *map = nullptr;
+  size_t mapSize = 0;
+};
@@ -0,0 +1,96 @@
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+StreamBuffer::StreamBuffer(size_t regionBytes, int regionCount)
+    : regionBytes(regionBytes), fences(std::max(regionCount, 2), nullptr) {
+  glGenBuffers(1, &VBO);
+  allocate();
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync fence : fences)
+    if (fence)
+      glDeleteSync(fence);
+  glDeleteBuffers(1, &VBO);
+}
+
+void StreamBuffer::allocate() {
+  for (GLsync &fence : fences) {
+    if (fence)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, regionBytes * fences.size(), NULL,
+               GL_STREAM_DRAW);
+  region = 0;
+  cursor = 0;
+}
+
+void StreamBuffer::setRegionBytes(size_t bytes) {
+  if (bytes == regionBytes)
+    return;
+  regionBytes = bytes;
+  allocate();
+}
+
+bool StreamBuffer::advance() {
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  region = (region + 1) % fences.size();
+  cursor = region * regionBytes;
+
+  GLsync &fence = fences[region];
+  if (!fence)
+    return true;
+  // Poll only: a zero timeout never blocks
+  GLenum state = glClientWaitSync(fence, 0, 0);
+  if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+    return false;
+  glDeleteSync(fence);
+  fence = nullptr;
+  return true;
+}
+
+size_t StreamBuffer::upload(const void *data, size_t bytes, size_t alignment) {
+  frame.uploads++;
+  frame.bytes += bytes;
+
+  // Callers keep batches within a region; should one not, make room
+  if (bytes > regionBytes) {
+    regionBytes = bytes * 2;
+    allocate();
+    frame.orphaned++;
+  } else {
+    cursor = (cursor + alignment - 1) / alignment * alignment;
+    bool free = true;
+    if (cursor + bytes > (region + 1) * regionBytes)
+      free = advance();
+    if (free) {
+      frame.stallFree++;
+    } else {
+      allocate();
+      frame.orphaned++;
+    }
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  size_t offset = cursor;
+  void *target = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                                  GL_MAP_WRITE_BIT |
+                                      GL_MAP_INVALIDATE_RANGE_BIT |
+                                      GL_MAP_UNSYNCHRONIZED_BIT);
+  if (target) {
+    memcpy(target, data, bytes);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  } else {
+    glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+  }
+  cursor += bytes;
+  return offset;
+}
+
+void StreamBuffer::beginFrame() {
+  lastFrame = frame;
+  frame = Stats();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "config.h"
+
+// Streaming vertex buffer for per-frame geometry. The buffer is split into
+// a ring of regions; each upload is written at the ring's cursor through
+// an unsynchronized map, and a fence is placed on a region when the cursor
+// leaves it. Coming back round to a region the GPU may still be reading
+// checks its fence without waiting: if it has not signalled, the buffer is
+// orphaned (fresh storage from the driver) instead of stalling the CPU.
+class StreamBuffer {
+public:
+  // Counters for one frame (see beginFrame)
+  struct Stats {
+    size_t uploads = 0;   // upload() calls
+    size_t stallFree = 0; // Written without waiting on the GPU
+    size_t orphaned = 0;  // Region still busy: storage was replaced instead
+    size_t bytes = 0;
+  };
+
+  StreamBuffer(size_t regionBytes, int regionCount = 3);
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  unsigned int getBuffer() const { return VBO; }
+  size_t getRegionBytes() const { return regionBytes; }
+  // Reallocates with a new region size (the old contents are dropped)
+  void setRegionBytes(size_t bytes);
+  // Copies data into the buffer and returns its byte offset. The buffer is
+  // left bound to GL_ARRAY_BUFFER. Offsets are multiples of `alignment`.
+  size_t upload(const void *data, size_t bytes, size_t alignment);
+
+  // Starts a new frame's counters; getStats() reports the last full frame
+  void beginFrame();
+  const Stats &getStats() const { return lastFrame; }
+
+private:
+  unsigned int VBO = 0;
+  size_t regionBytes;
+  std::vector<GLsync> fences; // One per region, null when free
+  size_t region = 0;          // Region the cursor is in
+  size_t cursor = 0;          // Byte offset of the next write
+  Stats frame, lastFrame;
+
+  void allocate();
+  // Moves the cursor to the start of the next region, fencing this one
+  bool advance();
+};
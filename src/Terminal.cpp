@@ -1,138 +1,216 @@
 #include "Terminal.h"
-#include "FontManager.h"
-#include "PTYHandler.h"
-#include "Renderer.h"
-#include <sstream>
+#include <algorithm>
 
-Terminal::Terminal(float width, float height)
+Terminal::Terminal(float width, float height, size_t scrollbackLines)
     : screenWidth(width), screenHeight(height), lineHeight(20.0f), scale(1.0f),
-      textColor(glm::vec3(1.0f, 1.0f, 1.0f)) {
+      scrollbackLines(scrollbackLines),
+      grid(getCols(), scrollbackLines + getRows(),
+           getRows() + HOT_SCROLLBACK_LINES) {
   // No initial prompt, the shell will provide it
-  // Default to Gold
-  currentColor = defaultColor;
 }
 
 // Helper to get number of visible rows
-int Terminal::getRows() { return (int)(screenHeight / lineHeight); }
-
-void Terminal::processOutput(std::string output) {
-  for (char c : output) {
-    if (parserState == ParserState::Normal) {
-      if (c == 27) { // ESC
-        parserState = ParserState::Esc;
-      } else if (c == '\n') {
-        cursorY++;
-        cursorX = 0;
-        // If we moved past the end, add a new line
-        if (cursorY >= lines.size()) {
-          lines.push_back(std::vector<TerminalGlyph>());
-          // Maintain scroll at bottom if we are outputting
-          scrollToBottom();
-        }
-        // Reset color? Usually color persists until changed.
-        // currentColor = defaultColor; // Terminals usually persist color
-        // across newlines
-      } else if (c == '\r') {
-        cursorX = 0;
-      } else if (c == '\b') {
-        if (cursorX > 0)
-          cursorX--;
-      } else if (c == 7) {
-        // bell
-      } else {
-        if (c >= 32 || c == 9) { // Printable or Tab
-          // Ensure line exists
-          while (lines.size() <= cursorY) {
-            lines.push_back(std::vector<TerminalGlyph>());
-          }
-
-          // Ensure space exists up to cursorX in current line
-          if (lines[cursorY].size() <= cursorX) {
-            while (lines[cursorY].size() <= cursorX) {
-              TerminalGlyph g;
-              g.character = ' ';
-              g.color = currentColor;
-              lines[cursorY].push_back(g);
-            }
-          }
-
-          // Overwrite at cursorX
-          lines[cursorY][cursorX].character = c;
-          lines[cursorY][cursorX].color = currentColor;
-          cursorX++;
-        }
-      }
-    } else if (parserState == ParserState::Esc) {
-      if (c == '[') {
-        parserState = ParserState::Csi;
-        csiParams = "";
-      } else {
-        parserState = ParserState::Normal;
-      }
-    } else if (parserState == ParserState::Csi) {
-      if (c >= '0' && c <= '9') {
-        csiParams += c;
-      } else if (c == ';') {
-        csiParams += c;
-      } else if (c >= 0x40 && c <= 0x7E) {
-        handleCsi(c);
-        parserState = ParserState::Normal;
-      }
+int Terminal::getRows() const { return (int)(screenHeight / lineHeight); }
+
+int Terminal::getCols() const {
+  // Same estimate the PTY size uses (11px cells at scale 1), so wrapping
+  // agrees with what the shell thinks the width is
+  int cols = (int)(screenWidth / (11.0f * scale));
+  return cols < 1 ? 1 : cols;
+}
+
+void Terminal::processOutput(std::string_view output) {
+  if (!output.empty())
+    dirty = true;
+
+  parser.feed(output, *this);
+}
+
+void Terminal::newLine() {
+  cursorY++;
+  cursorX = 0;
+  // If we moved past the end, add a new line
+  if (cursorY >= (int)grid.size()) {
+    addLine();
+    // Maintain scroll at bottom if we are outputting
+    scrollToBottom();
+  }
+  // Color persists across newlines until changed
+}
+
+void Terminal::addLine() {
+  if (size_t dropped = grid.pushLine())
+    linesDropped((int)dropped);
+}
+
+void Terminal::linesDropped(int count) {
+  // The oldest lines left the scrollback: everything moved up
+  cursorY = std::max(cursorY - count, 0);
+  if (selectionStart.row != -1) {
+    selectionStart.row -= count;
+    selectionEnd.row -= count;
+    if (selectionStart.row < 0 || selectionEnd.row < 0)
+      clearSelection();
+  }
+}
+
+void Terminal::ensureCursorLine() {
+  while (cursorY >= (int)grid.size())
+    addLine();
+}
+
+Cell *Terminal::beginWrite() {
+  ensureCursorLine();
+
+  // Deferred autowrap: the cursor sits past the last column after filling
+  // it, and only the next printed character moves to a new line
+  int cols = (int)grid.getColumns();
+  if (cursorX >= cols) {
+    if (autowrap) {
+      grid.setWrapped(cursorY, true);
+      newLine();
+    } else {
+      cursorX = cols - 1;
     }
   }
+
+  // Cells skipped over by cursor movement are filled with blanks
+  Cell *row = grid.rowCells(cursorY);
+  Cell blank = pen;
+  blank.codepoint = ' ';
+  for (size_t col = grid.getLength(cursorY); col < (size_t)cursorX; col++)
+    row[col] = blank;
+  return row;
+}
+
+void Terminal::endWrite(size_t count) {
+  cursorX += (int)count;
+  if ((size_t)cursorX > grid.getLength(cursorY))
+    grid.setLength(cursorY, cursorX);
+}
+
+void Terminal::vtPrint(uint32_t c) {
+  Cell *row = beginWrite();
+  Cell &cell = row[cursorX];
+  cell = pen;
+  cell.codepoint = c;
+  endWrite(1);
+}
+
+void Terminal::vtPrintAscii(const char *text, size_t length) {
+  // Fill the row in place a row-sized piece at a time
+  while (length > 0) {
+    Cell *row = beginWrite();
+    size_t count = std::min(length, grid.getColumns() - cursorX);
+    Cell *cell = row + cursorX;
+    for (size_t i = 0; i < count; i++) {
+      cell[i] = pen;
+      cell[i].codepoint = (unsigned char)text[i];
+    }
+    endWrite(count);
+    text += count;
+    length -= count;
+  }
+}
+
+void Terminal::vtExecute(uint8_t c) {
+  switch (c) {
+  case '\n':
+  case '\v': // VT and FF behave like LF
+  case '\f':
+    newLine();
+    break;
+  case '\r':
+    cursorX = 0;
+    break;
+  case '\b':
+    if (cursorX > 0)
+      cursorX--;
+    break;
+  case '\t':
+    // Next tab stop (every 8 columns); cells are filled in on print
+    cursorX = std::min((cursorX / 8 + 1) * 8, (int)grid.getColumns() - 1);
+    break;
+  case 7:
+    // bell
+    break;
+  default:
+    break;
+  }
+}
+
+void Terminal::vtEscDispatch(const VtParser &parser, uint8_t finalByte) {
+  // Charset designations (ESC ( B etc.), ST and the like: nothing to do
+}
+
+void Terminal::vtCsiDispatch(const VtParser &parser, uint8_t finalByte) {
+  handleCsi(parser, (char)finalByte);
+}
+
+void Terminal::vtOscDispatch(std::string_view data) {
+  // OSC Ps ; Pt  -- 0 = icon + title, 2 = title
+  size_t separator = data.find(';');
+  if (separator == std::string_view::npos)
+    return;
+  std::string_view command = data.substr(0, separator);
+  if (command == "0" || command == "2") {
+    title = std::string(data.substr(separator + 1));
+  }
 }
 
-void Terminal::handleCsi(char finalByte) {
-  // Parse params
-  std::vector<int> args;
-  std::stringstream ss(csiParams);
-  std::string segment;
-  while (std::getline(ss, segment, ';')) {
-    if (!segment.empty())
-      args.push_back(std::stoi(segment));
-    else
-      args.push_back(0); // Default encoding?
+void Terminal::handleCsi(const VtParser &parser, char finalByte) {
+  if (parser.hasIntermediate('?')) {
+    // DEC private modes: CSI ? Pm h (set) / CSI ? Pm l (reset)
+    if (finalByte == 'h' || finalByte == 'l') {
+      for (size_t i = 0; i < parser.getParamCount(); i++) {
+        if (parser.getParam(i) == 2004)
+          bracketedPaste = (finalByte == 'h');
+        else if (parser.getParam(i) == 7) // DECAWM
+          autowrap = (finalByte == 'h');
+      }
+    }
+    return;
   }
 
-  int arg1 = args.size() > 0 ? args[0] : 1; // Default 1
-  if (arg1 == 0)
-    arg1 = 1; // CSI 0 A means 1 A usually
+  // Other markers/intermediates (CSI > c, CSI SP q, ...) aren't supported
+  if (!parser.getIntermediates().empty())
+    return;
+
+  int arg1 = parser.getParam(0, 1); // CSI 0 A means 1 A usually
 
   if (finalByte == 'A') { // Up
-    cursorY -= arg1;
-    if (cursorY < 0)
-      cursorY = 0;
+    // Stops at the top of the screen; history above it is read-only
+    int top = std::max((int)grid.size() - getRows(), 0);
+    cursorY = std::max(cursorY - arg1, top);
   } else if (finalByte == 'B') { // Down
     cursorY += arg1;
     // Don't go past end? Or add lines?
     // Standard: Cursor Down stops at bottom margin.
-    // For now, clamp to lines.size()
-    if (cursorY >= lines.size())
-      cursorY = lines.size() - 1;
-    if (lines.empty())
-      cursorY = 0;
+    // For now, clamp to the last line
+    if (cursorY >= (int)grid.size())
+      cursorY = (int)grid.size() - 1;
   } else if (finalByte == 'C') { // Right
-    cursorX += arg1;
+    cursorX = std::min(cursorX + arg1, (int)grid.getColumns() - 1);
   } else if (finalByte == 'D') { // Left
     cursorX -= arg1;
     if (cursorX < 0)
       cursorX = 0;
   } else if (finalByte == 'H' || finalByte == 'f') { // Cup - Cursor Position
-    // args[0] is row (1-based), args[1] is col (1-based)
-    int r = (args.size() > 0 && args[0] > 0) ? args[0] : 1;
-    int c = (args.size() > 1 && args[1] > 0) ? args[1] : 1;
+    // First param is row (1-based), second is col (1-based)
+    int r = std::min(parser.getParam(0, 1), std::max(getRows(), 1));
+    int c = std::min(parser.getParam(1, 1), (int)grid.getColumns());
 
     // Map visual row to absolute row
     // Visual Row 1 = Top of screen
-    // Top of screen = lines.size() - getRows() ?
+    // Top of screen = grid.size() - getRows() ?
     // Wait, if we are scrolling...
     // Let's assume the screen "follows" the bottom.
     int termRows = getRows();
-    int topRowIndex = (int)lines.size() - termRows;
+    int topRowIndex = (int)grid.size() - termRows;
     if (topRowIndex < 0)
       topRowIndex = 0;
 
-    // Actually, if we clear screen, lines.size() might be 1.
+    // Actually, if we clear screen, grid.size() might be 1.
     // If we use 'H', we expect to jump to top.
     // If we assume the viewport is always locked to "end of buffer",
     // then "Top" is relative to that.
@@ -140,122 +218,245 @@ void Terminal::handleCsi(char finalByte) {
     cursorY = topRowIndex + (r - 1);
     cursorX = c - 1;
 
-    // Ensure we don't jump way past end?
-    // If program asks to go to row 50 and we have 1 line, we should extend?
-    // Usually terminals have fixed size buffer. We grow dynamically.
-    while (lines.size() <= cursorY) {
-      lines.push_back(std::vector<TerminalGlyph>());
-    }
+    // Rows below the last line are created on demand (clamped to the
+    // screen height above)
+    ensureCursorLine();
   } else if (finalByte == 'm') {
-    // SGR - Select Graphic Rendition
-    if (csiParams.empty() || csiParams == "0") {
-      currentColor = defaultColor;
-    } else {
-      // Manual loop as before
-      std::stringstream ss2(csiParams);
-      int currentVal = 0;
-      bool hasVal = false;
-      auto applyCode = [&](int code) {
-        if (code == 0) {
-          currentColor = defaultColor;
-        } else if (code >= 30 && code <= 37) {
-          static const glm::vec3 colors[] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0},
-                                             {1, 1, 0}, {0, 0, 1}, {1, 0, 1},
-                                             {0, 1, 1}, {1, 1, 1}};
-          currentColor = colors[code - 30];
-        }
-      };
-
-      for (char c : csiParams) {
-        if (c == ';') {
-          if (hasVal)
-            applyCode(currentVal);
-          currentVal = 0;
-          hasVal = false;
-        } else if (isdigit(c)) {
-          currentVal = currentVal * 10 + (c - '0');
-          hasVal = true;
-        }
-      }
-      if (hasVal)
-        applyCode(currentVal);
-    }
+    handleSgr(parser);
   } else if (finalByte == 'J') { // Erase in Display
-    if (csiParams == "2") {
-      lines.clear();
-      lines.push_back(std::vector<TerminalGlyph>());
+    if (parser.getParam(0) == 2) {
+      grid.clear();
       cursorX = 0;
       cursorY = 0;
     }
   } else if (finalByte == 'K') { // Erase in Line
     // 0: cursor to end, 1: start to cursor, 2: all
     // Default 0
-    int mode = csiParams.empty() ? 0 : std::stoi(csiParams);
-    if (lines.size() > cursorY) {
+    int mode = parser.getParam(0);
+    if ((int)grid.size() > cursorY) {
       if (mode == 0) {
-        if (lines[cursorY].size() > cursorX) {
-          lines[cursorY].resize(cursorX);
-        }
+        grid.truncate(cursorY, cursorX);
       } else if (mode == 2) {
-        lines[cursorY].clear();
+        grid.truncate(cursorY, 0);
       }
     }
   }
 }
 
-void Terminal::handleInput(int key, int action, int mods, PTYHandler &pty) {
-  if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-    // If user presses a key, jump to bottom (unless it's shift keys used for
-    // scrolling)
-    if (key != GLFW_KEY_LEFT_SHIFT && key != GLFW_KEY_RIGHT_SHIFT) {
-      scrollToBottom();
+void Terminal::handleSgr(const VtParser &parser) {
+  // SGR - Select Graphic Rendition. No parameters means reset.
+  size_t count = parser.getParamCount();
+  if (count == 0) {
+    pen = defaultPen;
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    int code = parser.getParam(i);
+    if (parser.isSubParam(i))
+      continue; // Sub-parameters of a code we don't support
+
+    if (code == 0) {
+      pen = defaultPen;
+    } else if (code >= 1 && code <= 9) {
+      pen.attributes |= 1 << (code - 1); // CellAttribute order follows SGR
+    } else if (code == 22) {
+      pen.attributes &= ~(ATTR_BOLD | ATTR_DIM);
+    } else if (code == 25) {
+      pen.attributes &= ~(ATTR_BLINK | ATTR_RAPID_BLINK);
+    } else if (code >= 23 && code <= 29 && code != 26) {
+      pen.attributes &= ~(1 << (code - 21));
+    } else if (code >= 30 && code <= 37) {
+      pen.fg = code - 30;
+    } else if (code == 39) {
+      pen.fg = COLOR_DEFAULT_FG;
+    } else if (code >= 40 && code <= 47) {
+      pen.bg = code - 40;
+    } else if (code == 49) {
+      pen.bg = COLOR_DEFAULT_BG;
+    } else if (code >= 90 && code <= 97) {
+      pen.fg = code - 90 + 8;
+    } else if (code >= 100 && code <= 107) {
+      pen.bg = code - 100 + 8;
+    } else if (code == 38 || code == 48) {
+      // Extended color, "38;5;n" / "38;2;r;g;b" or the same with ':'
+      bool colon = parser.isSubParam(i + 1);
+      int kind = parser.getParam(i + 1);
+      uint16_t color = 0;
+      size_t used = 1;
+      if (kind == 5) {
+        color = (uint16_t)(parser.getParam(i + 2) & 0xFF);
+        used = 2;
+      } else if (kind == 2) {
+        // The colon form may carry a color space id before r:g:b
+        size_t first = i + 2;
+        if (colon && parser.isSubParam(i + 5))
+          first++;
+        color = internTrueColor(parser.getParam(first),
+                                parser.getParam(first + 1),
+                                parser.getParam(first + 2));
+        used = first + 2 - i;
+      }
+      if (kind == 5 || kind == 2)
+        (code == 38 ? pen.fg : pen.bg) = color;
+
+      // Colon forms are skipped as sub-parameters by the check above
+      if (!colon)
+        i += used;
     }
+  }
+}
 
-    // User is typing -> Switch to Input Color (Gold)
-    currentColor = inputColor;
-
-    if (key == GLFW_KEY_ENTER) {
-      pty.writeInput("\n");
-    } else if (key == GLFW_KEY_BACKSPACE) {
-      char backspace = 127; // ASCII del
-      pty.writeInput(&backspace, 1);
-    } else if (key == GLFW_KEY_UP) {
-      pty.writeInput("\033[A");
-    } else if (key == GLFW_KEY_DOWN) {
-      pty.writeInput("\033[B");
-    } else if (key == GLFW_KEY_LEFT) {
-      pty.writeInput("\033[D");
-    } else if (key == GLFW_KEY_RIGHT) {
-      pty.writeInput("\033[C");
+uint16_t Terminal::internTrueColor(int r, int g, int b) {
+  r &= 0xFF;
+  g &= 0xFF;
+  b &= 0xFF;
+  uint32_t key = (uint32_t)(r << 16 | g << 8 | b);
+  auto it = trueColorIndex.find(key);
+  if (it != trueColorIndex.end())
+    return it->second;
+
+  if (trueColors.size() >= 0xFFFF - TRUECOLOR_BASE) {
+    // Table full: fall back to the nearest color of the 6x6x6 cube
+    auto level = [](int v) { return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40; };
+    return (uint16_t)(16 + 36 * level(r) + 6 * level(g) + level(b));
+  }
+
+  uint16_t index = (uint16_t)(TRUECOLOR_BASE + trueColors.size());
+  trueColors.push_back({r / 255.0f, g / 255.0f, b / 255.0f});
+  trueColorIndex[key] = index;
+  return index;
+}
+
+// The xterm 256-color palette. The first eight keep this terminal's pure
+// primaries; 8-15 are their bright variants.
+static const std::vector<Terminal::Color> &palette256() {
+  static const std::vector<Terminal::Color> palette = [] {
+    std::vector<Terminal::Color> colors = {
+        {0, 0, 0},       {1, 0, 0},       {0, 1, 0},       {1, 1, 0},
+        {0, 0, 1},       {1, 0, 1},       {0, 1, 1},       {1, 1, 1},
+        {0.5f, 0.5f, 0.5f}, {1, 0.4f, 0.4f}, {0.4f, 1, 0.4f}, {1, 1, 0.4f},
+        {0.4f, 0.4f, 1},    {1, 0.4f, 1},    {0.4f, 1, 1},    {1, 1, 1}};
+    static const int steps[] = {0, 95, 135, 175, 215, 255};
+    for (int r = 0; r < 6; r++)
+      for (int g = 0; g < 6; g++)
+        for (int b = 0; b < 6; b++)
+          colors.push_back(
+              {steps[r] / 255.0f, steps[g] / 255.0f, steps[b] / 255.0f});
+    for (int i = 0; i < 24; i++) {
+      float v = (8 + i * 10) / 255.0f;
+      colors.push_back({v, v, v});
     }
+    return colors;
+  }();
+  return palette;
+}
+
+Terminal::Color Terminal::resolveColor(uint16_t index) const {
+  if (index < 256)
+    return palette256()[index];
+  switch (index) {
+  case COLOR_DEFAULT_FG:
+    return defaultColor;
+  case COLOR_DEFAULT_BG:
+    return defaultBackground;
+  case COLOR_INPUT:
+    return inputColor;
   }
+  size_t entry = index - TRUECOLOR_BASE;
+  return entry < trueColors.size() ? trueColors[entry] : defaultColor;
+}
+
+void Terminal::onUserInput() {
+  // User is typing -> Switch to Input Color (Gold)
+  pen.fg = COLOR_INPUT;
 }
 
 void Terminal::appendText(std::string text) { processOutput(text); }
 
+static void appendUtf8(std::string &out, uint32_t c) {
+  char bytes[4];
+  out.append(bytes, encodeUtf8(c, bytes));
+}
+
+uint64_t Terminal::gridHash() const {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&](uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      hash ^= (value >> (i * 8)) & 0xFF;
+      hash *= 1099511628211ull;
+    }
+  };
+
+  for (size_t row = 0; row < grid.size(); row++) {
+    Grid::Row line = grid[row];
+    // Trailing blanks don't change what is on screen
+    size_t length = line.size();
+    while (length > 0 && line[length - 1].codepoint == ' ')
+      length--;
+
+    for (size_t i = 0; i < length; i++) {
+      mix(line[i].codepoint);
+      Color color = resolveColor(line[i].fg);
+      uint32_t r = (uint32_t)(color.r * 255.0f + 0.5f);
+      uint32_t g = (uint32_t)(color.g * 255.0f + 0.5f);
+      uint32_t b = (uint32_t)(color.b * 255.0f + 0.5f);
+      mix(r | (g << 8) | (b << 16));
+      // Only non-default styling, so plain text hashes as it always has
+      if (line[i].attributes || line[i].bg != COLOR_DEFAULT_BG)
+        mix(line[i].attributes | (uint32_t)line[i].bg << 16);
+    }
+    mix('\n');
+  }
+  mix(cursorX);
+  mix(cursorY);
+  return hash;
+}
+
 void Terminal::setSize(float width, float height) {
+  if (width != screenWidth || height != screenHeight)
+    dirty = true;
   screenWidth = width;
   screenHeight = height;
+  updateGridSize();
+}
+
+void Terminal::updateGridSize() {
+  size_t before = grid.size();
+  grid.resize(getCols(), scrollbackLines + getRows(),
+              getRows() + HOT_SCROLLBACK_LINES);
+  if (grid.size() < before)
+    linesDropped((int)(before - grid.size()));
+  cursorY = std::min(cursorY, (int)grid.size() - 1);
+  cursorY = std::max(cursorY, (int)grid.getFirstHotLine());
 }
 
 void Terminal::scroll(int amount) {
+  int oldOffset = scrollOffset;
   scrollOffset += amount;
   // Clamp
   int maxLines = (int)(screenHeight / lineHeight);
-  int totalLines = lines.size();
+  int totalLines = grid.size();
   if (totalLines <= maxLines) {
     scrollOffset = 0;
-    return;
+  } else {
+    int maxScroll = totalLines - maxLines;
+    if (scrollOffset > maxScroll)
+      scrollOffset = maxScroll;
+    if (scrollOffset < 0)
+      scrollOffset = 0;
   }
 
-  int maxScroll = totalLines - maxLines;
-  if (scrollOffset > maxScroll)
-    scrollOffset = maxScroll;
-  if (scrollOffset < 0)
-    scrollOffset = 0;
+  if (scrollOffset != oldOffset)
+    dirty = true;
 }
 
-void Terminal::scrollToBottom() { scrollOffset = 0; }
+void Terminal::scrollToBottom() {
+  if (scrollOffset != 0)
+    dirty = true;
+  scrollOffset = 0;
+}
 
 void Terminal::changeScale(float delta) {
   scale += delta;
@@ -267,6 +468,56 @@ void Terminal::changeScale(float delta) {
 
   // Update line height (Base 20.0f)
   lineHeight = 20.0f * scale;
+  updateGridSize();
+  dirty = true;
+}
+
+void Terminal::getVisibleRange(int &startLine, int &endLine) const {
+  int maxLines = (int)(screenHeight / lineHeight);
+
+  // Calculate start line based on scrollOffset
+  int totalLines = grid.size();
+  startLine = 0;
+
+  if (totalLines > maxLines) {
+    startLine = totalLines - maxLines - scrollOffset;
+    if (startLine < 0)
+      startLine = 0;
+  }
+
+  // We only draw up to maxLines
+  endLine = startLine + maxLines;
+  if (endLine > totalLines)
+    endLine = totalLines;
+}
+
+Terminal::RowStamp Terminal::getRowStamp(int line) const {
+  RowStamp stamp;
+  if (line >= 0 && line < (int)grid.size()) {
+    stamp.lineId = grid.getLineId(line);
+    stamp.generation = grid.getGeneration(line);
+  }
+  return stamp;
+}
+
+void Terminal::collectDamage(DamageState &state,
+                             std::vector<int> &damagedRows) const {
+  int startLine, endLine;
+  getVisibleRange(startLine, endLine);
+  int rows = std::max(getRows(), 0);
+
+  damagedRows.clear();
+  // A new or resized screen is damaged everywhere
+  bool all = state.rows.size() != (size_t)rows;
+  state.rows.resize(rows);
+  for (int row = 0; row < rows; row++) {
+    RowStamp stamp = getRowStamp(startLine + row < endLine ? startLine + row
+                                                           : -1);
+    if (all || stamp != state.rows[row]) {
+      state.rows[row] = stamp;
+      damagedRows.push_back(row);
+    }
+  }
 }
 
 // Selection Implementation
@@ -278,14 +529,9 @@ Terminal::Point Terminal::screenToGrid(float x, float y) {
   float distFromTop = topY - y;
   int row = (int)(distFromTop / lineHeight); // Visual row 0..N
 
-  int maxLines = (int)(screenHeight / lineHeight);
-  int totalLines = lines.size();
-  int startLine = 0;
-  if (totalLines > maxLines) {
-    startLine = totalLines - maxLines - scrollOffset;
-    if (startLine < 0)
-      startLine = 0;
-  }
+  int totalLines = grid.size();
+  int startLine, endLine;
+  getVisibleRange(startLine, endLine);
 
   int absoluteRow = startLine + row;
 
@@ -300,8 +546,6 @@ Terminal::Point Terminal::screenToGrid(float x, float y) {
     absoluteRow = 0;
   if (absoluteRow >= totalLines)
     absoluteRow = totalLines - 1;
-  if (lines.empty())
-    absoluteRow = 0;
 
   return {absoluteRow, col};
 }
@@ -310,20 +554,38 @@ void Terminal::startSelection(float mouseX, float mouseY) {
   selectionStart = screenToGrid(mouseX, mouseY);
   selectionEnd = selectionStart;
   isSelecting = true;
+  dirty = true;
 }
 
 void Terminal::updateSelection(float mouseX, float mouseY) {
   if (isSelecting) {
-    selectionEnd = screenToGrid(mouseX, mouseY);
+    Point p = screenToGrid(mouseX, mouseY);
+    if (!(p == selectionEnd)) {
+      selectionEnd = p;
+      dirty = true;
+    }
   }
 }
 
 void Terminal::clearSelection() {
+  if (isSelecting)
+    dirty = true;
   isSelecting = false;
   selectionStart = {-1, -1};
   selectionEnd = {-1, -1};
 }
 
+bool Terminal::getSelection(Point &start, Point &end) const {
+  if (!isSelecting || selectionStart.row == -1)
+    return false;
+
+  start = selectionStart;
+  end = selectionEnd;
+  if (end < start)
+    std::swap(start, end);
+  return true;
+}
+
 bool Terminal::hasSelection() const {
   return isSelecting && !(selectionStart == selectionEnd);
 }
@@ -342,21 +604,22 @@ std::string Terminal::getSelectionText() {
   std::string res = "";
 
   for (int r = p1.row; r <= p2.row; r++) {
-    if (r < 0 || r >= lines.size())
+    if (r < 0 || r >= (int)grid.size())
       continue;
 
-    const auto &line = lines[r];
+    Grid::Row line = grid[r];
     int startCol = (r == p1.row) ? p1.col : 0;
     int endCol = (r == p2.row) ? p2.col : 99999; // End of line
 
     for (int c = startCol; c <= endCol; c++) {
       if (c < line.size()) {
-        res += line[c].character;
+        appendUtf8(res, line[c].codepoint);
       } else if (c == line.size()) {
         // Determine if we should include a newline
         // Generally yes if we selected past the end
-        if (r != p2.row) { // Don't add newline if it's the very last selected
-                           // item unless we really selected it
+        // Don't add newline if it's the very last selected item unless we
+        // really selected it, or if the line wrapped onto the next row
+        if (r != p2.row && !grid.isWrapped(r)) {
           res += "\n";
         }
       }
@@ -365,126 +628,13 @@ std::string Terminal::getSelectionText() {
   return res;
 }
 
-void Terminal::render(Renderer &renderer, FontManager &fontManager,
-                      float deltaTime) {
-  float y = screenHeight - lineHeight; // Start from top
-  int maxLines = (int)(screenHeight / lineHeight);
-
-  // Calculate start line based on scrollOffset
-  int totalLines = lines.size();
-  int startLine = 0;
-
-  if (totalLines > maxLines) {
-    startLine = totalLines - maxLines - scrollOffset;
-    if (startLine < 0)
-      startLine = 0;
-  }
-
-  // We only draw up to maxLines
-  int endLine = startLine + maxLines;
-  if (endLine > totalLines)
-    endLine = totalLines;
-
-  // Cursor Blinking Logic
+bool Terminal::updateCursorBlink(float deltaTime) {
   cursorTimer += deltaTime;
-  if (cursorTimer >= 0.5f) {
+  if (cursorTimer >= CURSOR_BLINK_INTERVAL) {
     cursorTimer = 0.0f;
     showCursor = !showCursor;
+    dirty = true;
+    return true;
   }
-
-  // Selection Rects
-  Point p1 = selectionStart;
-  Point p2 = selectionEnd;
-  if (isSelecting && (p1.row != -1)) {
-    if (p2 < p1)
-      std::swap(p1, p2);
-
-    // Draw Selection Highlights
-    float selY = y;
-    for (int i = startLine; i < endLine; i++) {
-      // Check if row i is inside selection range (row-wise)
-      if (i >= p1.row && i <= p2.row) {
-        float x = 10.0f;
-        float charW = 11.0f * scale; // Estimate
-
-        // Define col range for this row
-        int startCol = (i == p1.row) ? p1.col : 0;
-        int endCol = (i == p2.row) ? p2.col : 99999;
-
-        // Render a big rect for the selected range in this line?
-        // Or char by char? Big rect is faster.
-
-        // Clamp endCol to line size (plus 1 for potential newline selection)
-        int lineLen = lines[i].size();
-        int actualEndCol = (endCol > lineLen)
-                               ? lineLen
-                               : endCol; // Allow selecting slightly past text
-
-        if (startCol <= actualEndCol) {
-          float startX = 10.0f + startCol * charW;
-          float width = (actualEndCol - startCol + 1) *
-                        charW; // +1 to capture the char itself
-          // If dragging backwards? No we swapped p1/p2.
-
-          // If startCol > actualEndCol (empty line or weirdness), width might
-          // be 0 or neg
-          if (width > 0) {
-            renderer.drawRect(startX, selY, width, lineHeight, selectionColor);
-          }
-        }
-      }
-      selY -= lineHeight;
-    }
-  }
-
-  for (int i = startLine; i < endLine; i++) {
-    float x = 10.0f; // Padding
-
-    // Draw cursor if this is the active line
-    bool isCurrentLine = (i == cursorY);
-
-    // Calculate cursor position by traversing glyphs up to cursorX
-    float cursorDrawX = x;
-
-    for (int j = 0; j < lines[i].size(); j++) {
-      const auto &glyph = lines[i][j];
-      if (isCurrentLine && j == cursorX) {
-        cursorDrawX = x;
-      }
-
-      // Render single codepoint
-      Character ch = fontManager.getCharacter(glyph.character);
-
-      GLfloat xpos = x + ch.Bearing.x * scale;
-      GLfloat ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-      GLfloat w = ch.Size.x * scale;
-      GLfloat h = ch.Size.y * scale;
-
-      // Draw Glyph
-      renderer.drawCodepoint(fontManager, glyph.character, x, y, scale,
-                             glyph.color);
-
-      x += (ch.Advance >> 6) * scale;
-    }
-
-    // If cursor is at the end (appending)
-    if (isCurrentLine && cursorX >= lines[i].size()) {
-      cursorDrawX = x;
-    }
-
-    // Draw Cursor
-    if (isCurrentLine && showCursor) {
-      // height typically lineHeight, width typically 10-ish?
-      // Let's assume width of a space or 'M'
-      float w = 10.0f;
-      // Try getting 'M' width
-      // Character chM = fontManager.getCharacter('M');
-      // w = (chM.Advance >> 6) * scale;
-
-      // Draw solid block
-      renderer.drawRect(cursorDrawX, y, w, lineHeight, cursorColor);
-    }
-
-    y -= lineHeight;
-  }
-}
\ No newline at end of file
+  return false;
+}
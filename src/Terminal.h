@@ -1,33 +1,109 @@
 #pragma once
 
-#include <glm/glm.hpp>
+#include "Cell.h"
+#include "Grid.h"
+#include "VtParser.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
-// Forward declarations
-class Renderer;
-class FontManager;
-class PTYHandler;
-
+// Escape-sequence parser, line buffer and selection state. Part of termcore:
+// no GL/GLFW/FreeType here, drawing and key mapping live in TerminalView.
 class Terminal {
 public:
-  Terminal(float width, float height);
+  // Lines kept above the screen by default
+  static constexpr size_t DEFAULT_SCROLLBACK_LINES = 1000000;
+  // Scrollback kept uncompressed in the Grid's ring; older lines are
+  // compressed in the background (see Scrollback)
+  static constexpr size_t HOT_SCROLLBACK_LINES = 1000;
+
+  Terminal(float width, float height,
+           size_t scrollbackLines = DEFAULT_SCROLLBACK_LINES);
+
+  struct Color {
+    float r, g, b;
+    bool operator==(const Color &other) const {
+      return r == other.r && g == other.g && b == other.b;
+    }
+    bool operator!=(const Color &other) const { return !(*this == other); }
+  };
 
   // PTY Integration
-  void processOutput(std::string output);
-  void handleInput(int key, int action, int mods, PTYHandler &pty);
-
-  // Rendering
-  void render(Renderer &renderer, FontManager &fontManager, float deltaTime);
+  void processOutput(std::string_view output);
+  // Called when the user types: switches to the input color
+  void onUserInput();
+
+  // Moves compressed history beyond residentBytes to a temporary file
+  // (see Scrollback::enableSpill)
+  bool enableScrollbackSpill(size_t residentBytes) {
+    return grid.enableSpill(residentBytes);
+  }
+
+  // Read access for the frontend
+  const Grid &getGrid() const { return grid; }
+  // RGB for a Cell::fg / Cell::bg index (see CellColor)
+  Color resolveColor(uint16_t index) const;
+  // Valid color indices are [0, getColorCount()); grows as truecolors are
+  // interned, existing entries never change
+  size_t getColorCount() const { return TRUECOLOR_BASE + trueColors.size(); }
+  // Range of line indices currently on screen, [startLine, endLine)
+  void getVisibleRange(int &startLine, int &endLine) const;
+
+  // Per-row damage. A RowStamp identifies what a line holds: which line it
+  // is and its content generation (see Grid). Each consumer (renderer,
+  // screen reader, remote client...) keeps its own DamageState;
+  // collectDamage() lists the screen rows (0 = top) whose stamp changed
+  // since that state was last updated (writes, erases, scrolling, resizes),
+  // then updates it. The cursor is not part of a row.
+  struct RowStamp {
+    uint64_t lineId = UINT64_MAX; // UINT64_MAX: no line on this row
+    uint64_t generation = 0;
+    bool operator==(const RowStamp &other) const {
+      return lineId == other.lineId && generation == other.generation;
+    }
+    bool operator!=(const RowStamp &other) const { return !(*this == other); }
+  };
+  struct DamageState {
+    std::vector<RowStamp> rows;
+  };
+  RowStamp getRowStamp(int line) const;
+  void collectDamage(DamageState &state, std::vector<int> &damagedRows) const;
+  int getCursorX() const { return cursorX; }
+  int getCursorY() const { return cursorY; }
+  bool isCursorVisible() const { return showCursor; }
+  float getLineHeight() const { return lineHeight; }
+  float getScreenWidth() const { return screenWidth; }
+  float getScreenHeight() const { return screenHeight; }
+
+  // Redraw scheduling: the main loop only draws when something changed
+  bool needsRedraw() const { return dirty; }
+  void clearRedraw() { dirty = false; }
+  // Advances the blink timer, returns true if the cursor toggled
+  bool updateCursorBlink(float deltaTime);
+  float timeUntilCursorBlink() const {
+    return CURSOR_BLINK_INTERVAL - cursorTimer;
+  }
+
+  // Hash of the buffer contents (characters, colors, cursor). Used by the
+  // replay tool to check parser/grid changes against recorded sessions.
+  uint64_t gridHash() const;
 
   // Resize handling
   void setSize(float width, float height);
-  int getRows();
+  int getRows() const;
+  int getCols() const;
 
   // Scrolling
   void scroll(int amount);
   void scrollToBottom();
 
+  // Set by DECSET 2004; pastes must be wrapped in ESC[200~ / ESC[201~
+  bool isBracketedPaste() const { return bracketedPaste; }
+  // Window title from OSC 0 / OSC 2
+  const std::string &getTitle() const { return title; }
+
   // Zoom
   void changeScale(float delta);
   float getScale() const { return scale; }
@@ -51,20 +127,19 @@ public:
   void clearSelection();
   std::string getSelectionText();
   bool hasSelection() const;
+  // Ordered selection bounds, false if nothing is being selected
+  bool getSelection(Point &start, Point &end) const;
 
 private:
   float screenWidth;
   float screenHeight;
   float lineHeight;
   float scale;
-  glm::vec3 textColor;
 
   // Selection State
   Point selectionStart = {-1, -1};
   Point selectionEnd = {-1, -1};
   bool isSelecting = false;
-  glm::vec3 selectionColor{0.3f, 0.3f,
-                           0.3f}; // Dark Grey background for selection
 
   // Helper to convert screen coordinates to grid coordinates
   Point screenToGrid(float x, float y);
@@ -72,40 +147,67 @@ private:
   // Scroll State
   int scrollOffset = 0; // 0 = at bottom/newest lines
 
-  // Color State
-  struct TerminalGlyph {
-    unsigned int character; // UTF-32
-    glm::vec3 color;
-  };
-  glm::vec3 currentColor{1.0f, 1.0f, 1.0f}; // Current drawing color
+  // Attributes and colors stamped on printed cells (codepoint unused)
+  const Cell defaultPen{' ', 0, COLOR_DEFAULT_FG, COLOR_DEFAULT_BG};
+  Cell pen = defaultPen;
 
   // Color configuration
-  const glm::vec3 defaultColor{1.0f, 1.0f, 1.0f}; // White for Output
-  const glm::vec3 inputColor{1.0f, 0.8f, 0.2f};   // Gold for Input
-  std::vector<std::vector<TerminalGlyph>> lines;
+  const Color defaultColor{1.0f, 1.0f, 1.0f};      // White for Output
+  const Color defaultBackground{0.0f, 0.0f, 0.0f}; // Only seen when inverted
+  const Color inputColor{1.0f, 0.8f, 0.2f};        // Gold for Input
+
+  // 24-bit SGR colors, interned: cells refer to them by index
+  std::vector<Color> trueColors;
+  std::unordered_map<uint32_t, uint16_t> trueColorIndex;
+  uint16_t internTrueColor(int r, int g, int b);
+
+  // Scrollback plus screen; bounded at scrollbackLines + getRows() lines,
+  // of which all but the newest HOT_SCROLLBACK_LINES + getRows() compressed
+  size_t scrollbackLines;
+  Grid grid;
+  bool autowrap = true; // DECAWM
 
   // Cursor State
   int cursorX = 0;
   int cursorY = 0;
   float cursorTimer = 0.0f;
   bool showCursor = true;
-  glm::vec3 cursorColor{0.0f, 1.0f, 1.0f}; // Default Cyan Cursor
+  static constexpr float CURSOR_BLINK_INTERVAL = 0.5f;
+
+  // Set whenever visible state changes, cleared by the main loop after drawing
+  bool dirty = true;
 
   // Internal helper
   void appendText(std::string text);
 
-  // UTF-8 Decoder State
-  uint32_t utf8State = 0;
-  uint32_t utf8Codepoint = 0;
-
   // ANSI Parser State
-  enum class ParserState {
-    Normal,
-    Esc,
-    Csi // Control Sequence Introducer like \x1b[
-  };
-  ParserState parserState = ParserState::Normal;
-  std::string csiParams;
-
-  void handleCsi(char finalByte);
+  VtParser parser;
+
+  // Terminal modes
+  bool bracketedPaste = false;
+  std::string title;
+
+  void newLine();
+  void addLine();
+  void linesDropped(int count);
+  void ensureCursorLine();
+  void updateGridSize();
+  // Prepare the cursor row for printing at cursorX (autowrap, gap fill);
+  // endWrite advances the cursor past the count cells written
+  Cell *beginWrite();
+  void endWrite(size_t count);
+  void handleCsi(const VtParser &parser, char finalByte);
+  void handleSgr(const VtParser &parser);
+
+  // VtParser callbacks
+  friend class VtParser;
+  void vtPrint(uint32_t c);
+  void vtPrintAscii(const char *text, size_t length);
+  void vtExecute(uint8_t c);
+  void vtEscDispatch(const VtParser &parser, uint8_t finalByte);
+  void vtCsiDispatch(const VtParser &parser, uint8_t finalByte);
+  void vtOscDispatch(std::string_view data);
+  void vtDcsHook(const VtParser &parser, uint8_t finalByte) {}
+  void vtDcsPut(uint8_t c) {}
+  void vtDcsUnhook() {}
 };
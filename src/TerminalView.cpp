@@ -0,0 +1,241 @@
+#include "TerminalView.h"
+#include "FontManager.h"
+#include "PTYHandler.h"
+#include "Renderer.h"
+#include <algorithm>
+#include <utility>
+
+TerminalView::TerminalView(Terminal &terminal) : terminal(terminal) {}
+
+void TerminalView::handleInput(int key, int action, int mods,
+                               PTYHandler &pty) {
+  if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+    // If user presses a key, jump to bottom (unless it's shift keys used for
+    // scrolling)
+    if (key != GLFW_KEY_LEFT_SHIFT && key != GLFW_KEY_RIGHT_SHIFT) {
+      terminal.scrollToBottom();
+    }
+
+    terminal.onUserInput();
+
+    if (key == GLFW_KEY_ENTER) {
+      pty.writeInput("\n");
+    } else if (key == GLFW_KEY_BACKSPACE) {
+      char backspace = 127; // ASCII del
+      pty.writeInput(&backspace, 1);
+    } else if (key == GLFW_KEY_UP) {
+      pty.writeInput("\033[A");
+    } else if (key == GLFW_KEY_DOWN) {
+      pty.writeInput("\033[B");
+    } else if (key == GLFW_KEY_LEFT) {
+      pty.writeInput("\033[D");
+    } else if (key == GLFW_KEY_RIGHT) {
+      pty.writeInput("\033[C");
+    }
+  }
+}
+
+static glm::vec3 toVec3(const Terminal::Color &color) {
+  return glm::vec3(color.r, color.g, color.b);
+}
+
+void TerminalView::render(Renderer &renderer, FontManager &fontManager) {
+  const Grid &grid = terminal.getGrid();
+  float scale = terminal.getScale();
+  float lineHeight = terminal.getLineHeight();
+  int cursorX = terminal.getCursorX();
+  int cursorY = terminal.getCursorY();
+
+  float y = terminal.getScreenHeight() - lineHeight; // Start from top
+
+  int startLine, endLine;
+  terminal.getVisibleRange(startLine, endLine);
+
+  // Selection Rects
+  Terminal::Point p1, p2;
+  if (terminal.getSelection(p1, p2)) {
+    // Draw Selection Highlights
+    float selY = y;
+    for (int i = startLine; i < endLine; i++) {
+      // Check if row i is inside selection range (row-wise)
+      if (i >= p1.row && i <= p2.row) {
+        float charW = 11.0f * scale; // Estimate
+
+        // Define col range for this row
+        int startCol = (i == p1.row) ? p1.col : 0;
+        int endCol = (i == p2.row) ? p2.col : 99999;
+
+        // Render a big rect for the selected range in this line?
+        // Or char by char? Big rect is faster.
+
+        // Clamp endCol to line size (plus 1 for potential newline selection)
+        int lineLen = grid[i].size();
+        int actualEndCol = (endCol > lineLen)
+                               ? lineLen
+                               : endCol; // Allow selecting slightly past text
+
+        if (startCol <= actualEndCol) {
+          float startX = 10.0f + startCol * charW;
+          float width = (actualEndCol - startCol + 1) *
+                        charW; // +1 to capture the char itself
+
+          // If startCol > actualEndCol (empty line or weirdness), width might
+          // be 0 or neg
+          if (width > 0) {
+            renderer.drawRect(startX, selY, width, lineHeight, selectionColor);
+          }
+        }
+      }
+      selY -= lineHeight;
+    }
+  }
+
+  // Layout changes move every glyph: start the cache over
+  int rows = std::max(terminal.getRows(), 0);
+  auto resetCache = [&]() {
+    // Per cell: a background, a glyph and up to two decorations
+    rowCache.reset(rows, instanced ? 0 : cachedColumns * 4);
+    if (instanced)
+      gridRenderer.reset(rows, cachedColumns);
+    damage = Terminal::DamageState();
+  };
+  if (scale != cachedScale || terminal.getScreenHeight() != cachedHeight ||
+      grid.getColumns() != cachedColumns || (size_t)rows != rowCache.size() ||
+      instanced != cachedInstanced ||
+      fontManager.getEvictionCount() != cachedEvictions) {
+    cachedScale = scale;
+    cachedHeight = terminal.getScreenHeight();
+    cachedColumns = grid.getColumns();
+    cachedInstanced = instanced;
+    resetCache();
+  }
+
+  auto rebuildDamaged = [&]() {
+    terminal.collectDamage(damage, damagedRows);
+    for (int row : damagedRows) {
+      int line = startLine + row < endLine ? startLine + row : -1;
+      if (instanced)
+        rebuildInstances(row, line, fontManager);
+      else
+        rebuildRow(row, line, y - row * lineHeight, fontManager);
+    }
+  };
+  cachedEvictions = fontManager.getEvictionCount();
+  rebuildDamaged();
+  // Loading new glyphs evicted old ones that undamaged rows may still show.
+  // Rebuild everything once: each rebuilt row stamps its glyphs for this
+  // frame, so later evictions in the pass can't touch them.
+  if (fontManager.getEvictionCount() != cachedEvictions) {
+    resetCache();
+    rebuildDamaged();
+    cachedEvictions = fontManager.getEvictionCount();
+  }
+
+  if (instanced) {
+    // Monospace: every cell is as wide as a space
+    float cellWidth = (fontManager.getCharacter(' ').Advance >> 6) * scale;
+    renderer.drawGrid(gridRenderer, terminal, fontManager, cellWidth, 10.0f,
+                      y);
+
+    int cursorRow = cursorY - startLine;
+    if (terminal.isCursorVisible() && cursorY < endLine && cursorRow >= 0 &&
+        cursorRow < rows) {
+      int column = std::min(std::max(cursorX, 0), (int)grid[cursorY].size());
+      renderer.drawRect(10.0f + column * cellWidth,
+                        y - cursorRow * lineHeight, 10.0f, lineHeight,
+                        cursorColor);
+    }
+    return;
+  }
+
+  // Backgrounds, glyphs and decorations of every row in one call
+  renderer.drawRows(rowCache, fontManager);
+
+  // Cursor: a solid block at the cursor's cell (or the end of the line)
+  int cursorRow = cursorY - startLine;
+  if (terminal.isCursorVisible() && cursorY < endLine && cursorRow >= 0 &&
+      cursorRow < (int)rowCache.size()) {
+    const auto &cellX = rowCache.getRow(cursorRow).cellX;
+    float cursorDrawX =
+        cellX[std::min((size_t)std::max(cursorX, 0), cellX.size() - 1)];
+    renderer.drawRect(cursorDrawX, y - cursorRow * lineHeight, 10.0f,
+                      lineHeight, cursorColor);
+  }
+}
+
+void TerminalView::rebuildRow(int screenRow, int line, float y,
+                              FontManager &fontManager) {
+  RowCache::Row &row = rowCache.getRow(screenRow);
+  row.cellX.clear();
+  for (auto &layer : rowLayers)
+    layer.clear();
+  std::vector<Vertex> &backgrounds = rowLayers[RowCache::BACKGROUNDS];
+  std::vector<Vertex> &glyphs = rowLayers[RowCache::GLYPHS];
+  std::vector<Vertex> &decorations = rowLayers[RowCache::DECORATIONS];
+  glm::vec2 white = fontManager.getWhiteUV();
+
+  float scale = terminal.getScale();
+  float lineHeight = terminal.getLineHeight();
+  float x = 10.0f; // Padding
+
+  if (line >= 0) {
+    Grid::Row cells = terminal.getGrid()[line];
+    for (const Cell &cell : cells) {
+      const Character &ch = fontManager.getCharacter(cell.codepoint);
+      float advance = (ch.Advance >> 6) * scale;
+      row.cellX.push_back(x);
+
+      // Cells store palette indices; resolve them to RGB here
+      uint16_t fgIndex = cell.fg;
+      uint16_t bgIndex = cell.bg;
+      if (cell.attributes & ATTR_INVERSE)
+        std::swap(fgIndex, bgIndex);
+      if (bgIndex != COLOR_DEFAULT_BG)
+        Renderer::appendRectQuad(backgrounds, x, y, advance, lineHeight,
+                                 toVec3(terminal.resolveColor(bgIndex)),
+                                 white);
+
+      glm::vec3 fg = toVec3(terminal.resolveColor(fgIndex));
+      if (cell.attributes & ATTR_DIM)
+        fg *= 0.6f;
+
+      if (!(cell.attributes & ATTR_INVISIBLE)) {
+        Renderer::appendGlyphQuad(glyphs, ch, x, y, scale, fg);
+
+        if (cell.attributes & ATTR_UNDERLINE)
+          Renderer::appendRectQuad(decorations, x, y + 2.0f * scale, advance,
+                                   scale, fg, white);
+        if (cell.attributes & ATTR_STRIKETHROUGH)
+          Renderer::appendRectQuad(decorations, x, y + lineHeight * 0.4f,
+                                   advance, scale, fg, white);
+      }
+      x += advance;
+    }
+  }
+  row.cellX.push_back(x);
+  rowCache.upload(screenRow, rowLayers);
+}
+
+void TerminalView::rebuildInstances(int screenRow, int line,
+                                    FontManager &fontManager) {
+  rowInstances.clear();
+  if (line >= 0) {
+    Grid::Row cells = terminal.getGrid()[line];
+    for (const Cell &cell : cells) {
+      GridRenderer::Instance instance{};
+      instance.glyph = gridRenderer.glyphSlot(fontManager, cell.codepoint);
+      instance.fg = cell.fg;
+      instance.bg = cell.bg;
+      if (cell.attributes & ATTR_INVERSE)
+        std::swap(instance.fg, instance.bg);
+      instance.flags = cell.attributes;
+      // Invisible text keeps its background but loses its decorations
+      if (cell.attributes & ATTR_INVISIBLE)
+        instance.flags &= ~(ATTR_UNDERLINE | ATTR_STRIKETHROUGH);
+      if (instance.bg != COLOR_DEFAULT_BG)
+        instance.flags |= GridRenderer::FLAG_BACKGROUND;
+      rowInstances.push_back(instance);
+    }
+  }
+  gridRenderer.setRow(screenRow, rowInstances);
+}
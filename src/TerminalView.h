@@ -0,0 +1,54 @@
+#pragma once
+
+#include "GridRenderer.h"
+#include "RowCache.h"
+#include "Terminal.h"
+#include "config.h"
+
+class Renderer;
+class FontManager;
+class PTYHandler;
+
+// GL frontend for a Terminal: draws its lines/cursor/selection and maps GLFW
+// keys to the byte sequences the shell expects.
+class TerminalView {
+public:
+  TerminalView(Terminal &terminal);
+
+  void render(Renderer &renderer, FontManager &fontManager);
+  void handleInput(int key, int action, int mods, PTYHandler &pty);
+
+  // Draw the grid with GridRenderer (one instance per cell) instead of
+  // per-row vertex slots
+  void setInstanced(bool enabled) { instanced = enabled; }
+  bool isInstanced() const { return instanced; }
+
+private:
+  Terminal &terminal;
+
+  glm::vec3 selectionColor{0.3f, 0.3f,
+                           0.3f};          // Dark Grey background for selection
+  glm::vec3 cursorColor{0.0f, 1.0f, 1.0f}; // Default Cyan Cursor
+
+  // Glyph geometry of the visible rows, rebuilt only for damaged rows
+  RowCache rowCache;
+  Terminal::DamageState damage;
+  std::vector<int> damagedRows;
+  // Layout the cache was built for; any change rebuilds every row
+  float cachedScale = 0.0f;
+  float cachedHeight = 0.0f;
+  size_t cachedColumns = 0;
+  // Atlas evictions move glyphs, so cached rows may point at reused slots
+  uint64_t cachedEvictions = 0;
+  // Scratch for rebuilding a row, one vector per RowCache::Layer
+  std::vector<Vertex> rowLayers[RowCache::LAYERS];
+
+  // Instanced path: same damage tracking, cells instead of vertices
+  GridRenderer gridRenderer;
+  bool instanced = false;
+  bool cachedInstanced = false;
+  std::vector<GridRenderer::Instance> rowInstances;
+
+  void rebuildRow(int screenRow, int line, float y, FontManager &fontManager);
+  void rebuildInstances(int screenRow, int line, FontManager &fontManager);
+};
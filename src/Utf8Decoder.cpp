@@ -0,0 +1,126 @@
+#include "Utf8Decoder.h"
+#include "AsciiScan.h"
+#include <cstring>
+
+// Sequence length announced by a lead byte; 0 for bytes that can never
+// start a sequence (continuations, overlong C0/C1, beyond U+10FFFF)
+static int sequenceLength(unsigned char lead) {
+  if (lead < 0x80)
+    return 1;
+  if (lead >= 0xC2 && lead <= 0xDF)
+    return 2;
+  if (lead >= 0xE0 && lead <= 0xEF)
+    return 3;
+  if (lead >= 0xF0 && lead <= 0xF4)
+    return 4;
+  return 0;
+}
+
+// Number of bytes at s (at most available) that form a valid prefix of the
+// sequence led by s[0]. The second byte's range depends on the lead so that
+// overlongs, surrogates and values above U+10FFFF are rejected early.
+static int validPrefix(const unsigned char *s, size_t available, int length) {
+  int count = 1;
+  if (available < 2)
+    return count;
+
+  unsigned char lo = 0x80, hi = 0xBF;
+  switch (s[0]) {
+  case 0xE0:
+    lo = 0xA0;
+    break;
+  case 0xED:
+    hi = 0x9F;
+    break;
+  case 0xF0:
+    lo = 0x90;
+    break;
+  case 0xF4:
+    hi = 0x8F;
+    break;
+  }
+  if (s[1] < lo || s[1] > hi)
+    return count;
+  count++;
+
+  while (count < length && (size_t)count < available &&
+         (s[count] & 0xC0) == 0x80)
+    count++;
+  return count;
+}
+
+static uint32_t decodeSequence(const unsigned char *s, int length) {
+  switch (length) {
+  case 2:
+    return ((s[0] & 0x1Fu) << 6) | (s[1] & 0x3Fu);
+  case 3:
+    return ((s[0] & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu);
+  default:
+    return ((s[0] & 0x07u) << 18) | ((s[1] & 0x3Fu) << 12) |
+           ((s[2] & 0x3Fu) << 6) | (s[3] & 0x3Fu);
+  }
+}
+
+size_t Utf8Decoder::decode(const unsigned char *data, size_t size,
+                           uint32_t *out) {
+  uint32_t *start = out;
+  size_t i = 0;
+
+  // Finish the sequence left over from the previous call
+  if (pendingLength > 0) {
+    int length = sequenceLength(pending[0]);
+    while (i < size && pendingLength < length) {
+      pending[pendingLength] = data[i];
+      if (validPrefix(pending, pendingLength + 1, length) <= pendingLength)
+        break; // data[i] doesn't continue it; decoded below on its own
+      pendingLength++;
+      i++;
+    }
+    if (pendingLength == length) {
+      *out++ = decodeSequence(pending, length);
+      pendingLength = 0;
+    } else if (i < size) {
+      *out++ = REPLACEMENT;
+      pendingLength = 0;
+    } else {
+      return 0; // Still incomplete
+    }
+  }
+
+  while (i < size) {
+    // ASCII stretch: widen it without looking at individual bytes
+    size_t run = scanPrintableAscii(data + i, size - i);
+    for (size_t k = 0; k < run; k++)
+      out[k] = data[i + k];
+    out += run;
+    i += run;
+    if (i == size)
+      break;
+
+    unsigned char lead = data[i];
+    int length = sequenceLength(lead);
+    if (length <= 1) {
+      // Stray continuation/invalid lead, or a byte the caller should have
+      // handled itself (controls)
+      *out++ = length ? lead : REPLACEMENT;
+      i++;
+      continue;
+    }
+
+    size_t available = size - i;
+    int valid = validPrefix(data + i, available, length);
+    if (valid == length) {
+      *out++ = decodeSequence(data + i, length);
+      i += length;
+    } else if ((size_t)valid == available) {
+      // Cut off by the end of the chunk: wait for the rest
+      memcpy(pending, data + i, valid);
+      pendingLength = (uint8_t)valid;
+      i += valid;
+    } else {
+      *out++ = REPLACEMENT;
+      i += valid;
+    }
+  }
+  return out - start;
+}
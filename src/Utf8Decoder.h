@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Incremental UTF-8 to UTF-32 decoder for terminal text runs.
+//
+// ASCII stretches are found with the SIMD byte scan and widened in bulk;
+// multibyte sequences are decoded and validated a whole sequence at a time
+// (no per-byte state machine). Malformed input becomes U+FFFD, one per
+// maximal invalid subpart as the Unicode standard recommends, so a stray
+// byte never swallows the text after it.
+//
+// A sequence cut off at the end of one read is kept and completed by the
+// next call to decode().
+class Utf8Decoder {
+public:
+  static constexpr uint32_t REPLACEMENT = 0xFFFD;
+
+  // Decodes size bytes into out, which must have room for size + 1
+  // codepoints. Returns the number of codepoints written.
+  size_t decode(const unsigned char *data, size_t size, uint32_t *out);
+
+  // Whether a sequence is waiting for continuation bytes
+  bool hasPending() const { return pendingLength > 0; }
+
+  // Abandons a pending sequence (a control byte interrupted it). Returns
+  // true if one was dropped; it then prints as a single U+FFFD.
+  bool flush() {
+    bool dropped = pendingLength > 0;
+    pendingLength = 0;
+    return dropped;
+  }
+
+private:
+  unsigned char pending[4];
+  uint8_t pendingLength = 0;
+};
+
+// Encodes one codepoint as UTF-8 into out (room for 4 bytes). Returns the
+// number of bytes written.
+inline size_t encodeUtf8(uint32_t c, char *out) {
+  if (c < 0x80) {
+    out[0] = (char)c;
+    return 1;
+  }
+  if (c < 0x800) {
+    out[0] = (char)(0xC0 | c >> 6);
+    out[1] = (char)(0x80 | (c & 0x3F));
+    return 2;
+  }
+  if (c < 0x10000) {
+    out[0] = (char)(0xE0 | c >> 12);
+    out[1] = (char)(0x80 | (c >> 6 & 0x3F));
+    out[2] = (char)(0x80 | (c & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | c >> 18);
+  out[1] = (char)(0x80 | (c >> 12 & 0x3F));
+  out[2] = (char)(0x80 | (c >> 6 & 0x3F));
+  out[3] = (char)(0x80 | (c & 0x3F));
+  return 4;
+}
@@ -0,0 +1,482 @@
+#pragma once
+
+#include "AsciiScan.h"
+#include "Utf8Decoder.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// DEC/ANSI escape-sequence parser after Paul Williams' VT500 state diagram
+// (https://vt100.net/emu/dec_ansi_parser).
+//
+// The diagram's byte ranges are expanded at compile time into a
+// [state][byte] table of packed (next state, action) entries, so feeding a
+// byte is a single table lookup. Entry/exit actions only run on the rare
+// transitions that change state.
+//
+// In the ground state, runs of printable ASCII skip the table entirely: a
+// SIMD scan finds the next control/non-ASCII byte and the whole run is
+// handed over in one call. In UTF-8 mode, text containing bytes >= 0x80 is
+// decoded by Utf8Decoder (up to the next control) and printed as codepoints.
+//
+// The parser only tokenizes; a Performer receives the results:
+//   void vtPrint(uint32_t c);
+//   void vtPrintAscii(const char *text, size_t length); // 0x20-0x7E only
+//   void vtExecute(uint8_t c);
+//   void vtEscDispatch(const VtParser &parser, uint8_t finalByte);
+//   void vtCsiDispatch(const VtParser &parser, uint8_t finalByte);
+//   void vtOscDispatch(std::string_view data);
+//   void vtDcsHook(const VtParser &parser, uint8_t finalByte);
+//   void vtDcsPut(uint8_t c);
+//   void vtDcsUnhook();
+class VtParser {
+public:
+  enum class State : uint8_t {
+    Ground,
+    Escape,
+    EscapeIntermediate,
+    CsiEntry,
+    CsiParam,
+    CsiIntermediate,
+    CsiIgnore,
+    OscString,
+    DcsEntry,
+    DcsParam,
+    DcsIntermediate,
+    DcsPassthrough,
+    DcsIgnore,
+    SosPmApcString,
+    Count
+  };
+
+  enum class Action : uint8_t {
+    None,
+    Print,
+    Execute,
+    Collect,
+    Param,
+    EscDispatch,
+    CsiDispatch,
+    Put,
+    OscPut,
+    Ignore
+  };
+
+  // In UTF-8 mode (the default) bytes 0x80-0xFF are UTF-8 text, as in xterm
+  // with a UTF-8 locale. Otherwise 0x80-0x9F are 8-bit C1 controls and
+  // 0xA0-0xFF print as Latin-1.
+  void setUtf8(bool enabled) {
+    table = enabled ? &UTF8_TABLE : &C1_TABLE;
+    utf8.flush();
+  }
+
+  State getState() const { return state; }
+
+  // Sequence data, valid during the dispatch callbacks.
+  //
+  // Parameters are accumulated as integers while parsing, ';' and ':'
+  // separated alike, so "38:2::255:0:0" is six parameters with the last five
+  // marked as sub-parameters. An empty parameter reads as 0, values clamp at
+  // MAX_PARAM_VALUE and parameters beyond MAX_PARAMS are dropped.
+  size_t getParamCount() const { return paramCount; }
+  int getParam(size_t index) const {
+    return index < paramCount ? params[index] : 0;
+  }
+  // Like getParam, but a missing or 0 parameter gives defaultValue (the
+  // usual reading for cursor movement counts and positions)
+  int getParam(size_t index, int defaultValue) const {
+    int value = getParam(index);
+    return value ? value : defaultValue;
+  }
+  // Whether the parameter was separated from its predecessor by ':'
+  bool isSubParam(size_t index) const {
+    return index < paramCount && (subParamMask >> index) & 1;
+  }
+
+  static constexpr size_t MAX_PARAMS = 32;
+  static constexpr int MAX_PARAM_VALUE = 65535;
+
+  std::string_view getIntermediates() const {
+    return std::string_view(intermediates, intermediateCount);
+  }
+  bool hasIntermediate(char c) const {
+    return getIntermediates().find(c) != std::string_view::npos;
+  }
+
+  template <typename Performer>
+  void feed(std::string_view data, Performer &performer);
+
+private:
+  // Packed table entry: bits 0-3 next state, bits 4-7 action, bit 8 set when
+  // this is a transition (exit/entry actions run, even when re-entering the
+  // same state).
+  using Entry = uint16_t;
+  using Table = std::array<std::array<Entry, 256>, (size_t)State::Count>;
+
+  static constexpr Entry TRANSITION = 0x100;
+  static constexpr Entry pack(State next, Action action, bool transition) {
+    return (Entry)((uint8_t)next | ((uint8_t)action << 4) |
+                   (transition ? TRANSITION : 0));
+  }
+
+  static constexpr Entry event(State current, Action action) {
+    return pack(current, action, false);
+  }
+  static constexpr Entry go(State next, Action action = Action::None) {
+    return pack(next, action, true);
+  }
+
+  static constexpr bool isC0(int c) {
+    return c <= 0x17 || c == 0x19 || (c >= 0x1C && c <= 0x1F);
+  }
+
+  static constexpr Entry transitionFor(State s, int c, bool utf8) {
+    // "Anywhere" transitions
+    if (c == 0x18 || c == 0x1A)
+      return go(State::Ground, Action::Execute);
+    if (c == 0x1B)
+      return go(State::Escape);
+    if (!utf8 && c >= 0x80 && c <= 0x9F) {
+      if (c == 0x90)
+        return go(State::DcsEntry);
+      if (c == 0x9B)
+        return go(State::CsiEntry);
+      if (c == 0x9C)
+        return go(State::Ground);
+      if (c == 0x9D)
+        return go(State::OscString);
+      if (c == 0x98 || c == 0x9E || c == 0x9F)
+        return go(State::SosPmApcString);
+      return go(State::Ground, Action::Execute);
+    }
+    bool high = c >= 0x80;
+
+    switch (s) {
+    case State::Ground:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c == 0x7F)
+        return event(s, Action::Ignore);
+      return event(s, Action::Print);
+
+    case State::Escape:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c >= 0x20 && c <= 0x2F)
+        return go(State::EscapeIntermediate, Action::Collect);
+      if (c == '[')
+        return go(State::CsiEntry);
+      if (c == ']')
+        return go(State::OscString);
+      if (c == 'P')
+        return go(State::DcsEntry);
+      if (c == 'X' || c == '^' || c == '_')
+        return go(State::SosPmApcString);
+      if (c >= 0x30 && c <= 0x7E)
+        return go(State::Ground, Action::EscDispatch);
+      return event(s, Action::Ignore);
+
+    case State::EscapeIntermediate:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c >= 0x20 && c <= 0x2F)
+        return event(s, Action::Collect);
+      if (c >= 0x30 && c <= 0x7E)
+        return go(State::Ground, Action::EscDispatch);
+      return event(s, Action::Ignore);
+
+    case State::CsiEntry:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c >= 0x20 && c <= 0x2F)
+        return go(State::CsiIntermediate, Action::Collect);
+      if (c >= 0x30 && c <= 0x3B) // Digits, ':' sub-params, ';'
+        return go(State::CsiParam, Action::Param);
+      if (c >= 0x3C && c <= 0x3F) // Private markers '<' '=' '>' '?'
+        return go(State::CsiParam, Action::Collect);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::Ground, Action::CsiDispatch);
+      return event(s, Action::Ignore);
+
+    case State::CsiParam:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c >= 0x30 && c <= 0x3B)
+        return event(s, Action::Param);
+      if (c >= 0x3C && c <= 0x3F)
+        return go(State::CsiIgnore);
+      if (c >= 0x20 && c <= 0x2F)
+        return go(State::CsiIntermediate, Action::Collect);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::Ground, Action::CsiDispatch);
+      return event(s, Action::Ignore);
+
+    case State::CsiIntermediate:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c >= 0x20 && c <= 0x2F)
+        return event(s, Action::Collect);
+      if (c >= 0x30 && c <= 0x3F)
+        return go(State::CsiIgnore);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::Ground, Action::CsiDispatch);
+      return event(s, Action::Ignore);
+
+    case State::CsiIgnore:
+      if (isC0(c))
+        return event(s, Action::Execute);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::Ground);
+      return event(s, Action::Ignore);
+
+    case State::DcsEntry:
+      if (c >= 0x20 && c <= 0x2F)
+        return go(State::DcsIntermediate, Action::Collect);
+      if ((c >= 0x30 && c <= 0x39) || c == 0x3B)
+        return go(State::DcsParam, Action::Param);
+      if (c == 0x3A)
+        return go(State::DcsIgnore);
+      if (c >= 0x3C && c <= 0x3F)
+        return go(State::DcsParam, Action::Collect);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::DcsPassthrough);
+      return event(s, Action::Ignore);
+
+    case State::DcsParam:
+      if ((c >= 0x30 && c <= 0x39) || c == 0x3B)
+        return event(s, Action::Param);
+      if (c == 0x3A || (c >= 0x3C && c <= 0x3F))
+        return go(State::DcsIgnore);
+      if (c >= 0x20 && c <= 0x2F)
+        return go(State::DcsIntermediate, Action::Collect);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::DcsPassthrough);
+      return event(s, Action::Ignore);
+
+    case State::DcsIntermediate:
+      if (c >= 0x20 && c <= 0x2F)
+        return event(s, Action::Collect);
+      if (c >= 0x30 && c <= 0x3F)
+        return go(State::DcsIgnore);
+      if (c >= 0x40 && c <= 0x7E)
+        return go(State::DcsPassthrough);
+      return event(s, Action::Ignore);
+
+    case State::DcsPassthrough:
+      if (c == 0x7F)
+        return event(s, Action::Ignore);
+      return event(s, Action::Put);
+
+    case State::OscString:
+      if (c == 0x07) // BEL terminates OSC (xterm)
+        return go(State::Ground);
+      if (c >= 0x20 && (c != 0x7F || high))
+        return event(s, Action::OscPut);
+      return event(s, Action::Ignore);
+
+    case State::DcsIgnore:
+    case State::SosPmApcString:
+    case State::Count:
+      break;
+    }
+    return event(s, Action::Ignore);
+  }
+
+  static constexpr Table buildTable(bool utf8) {
+    Table t{};
+    for (int s = 0; s < (int)State::Count; s++) {
+      for (int c = 0; c < 256; c++) {
+        t[s][c] = transitionFor((State)s, c, utf8);
+      }
+    }
+    return t;
+  }
+
+  static const Table UTF8_TABLE; // Defined below, once buildTable is complete
+  static const Table C1_TABLE;
+
+  // Longest OSC payload kept (titles, hyperlinks); the rest is dropped
+  static constexpr size_t MAX_OSC_LENGTH = 4096;
+  static constexpr size_t MAX_INTERMEDIATES = 2;
+
+  const Table *table = &UTF8_TABLE;
+  State state = State::Ground;
+  Utf8Decoder utf8;
+
+  // Codepoints decoded per batch in printUtf8
+  static constexpr size_t UTF8_BATCH = 256;
+
+  uint16_t params[MAX_PARAMS];
+  size_t paramCount = 0;
+  uint32_t subParamMask = 0;
+  bool paramOverflow = false;
+  char intermediates[MAX_INTERMEDIATES];
+  size_t intermediateCount = 0;
+  bool intermediateOverflow = false;
+  std::string oscData;
+
+  void clear() {
+    paramCount = 0;
+    subParamMask = 0;
+    paramOverflow = false;
+    intermediateCount = 0;
+    intermediateOverflow = false;
+  }
+
+  void collect(uint8_t c) {
+    if (intermediateCount < MAX_INTERMEDIATES)
+      intermediates[intermediateCount++] = (char)c;
+    else
+      intermediateOverflow = true;
+  }
+
+  void param(uint8_t c) {
+    if (paramOverflow)
+      return;
+    if (paramCount == 0)
+      params[paramCount++] = 0;
+    if (c >= '0' && c <= '9') {
+      int value = params[paramCount - 1] * 10 + (c - '0');
+      params[paramCount - 1] =
+          (uint16_t)(value > MAX_PARAM_VALUE ? MAX_PARAM_VALUE : value);
+    } else if (paramCount == MAX_PARAMS) {
+      paramOverflow = true;
+    } else { // ';' or ':' starts the next parameter
+      if (c == ':')
+        subParamMask |= 1u << paramCount;
+      params[paramCount++] = 0;
+    }
+  }
+
+  template <typename Performer>
+  void printUtf8(const unsigned char *data, size_t size, Performer &performer);
+  template <typename Performer>
+  void changeState(State next, uint8_t c, Action action, Performer &performer);
+  template <typename Performer>
+  void perform(Action action, uint8_t c, Performer &performer);
+};
+
+inline constexpr VtParser::Table VtParser::UTF8_TABLE =
+    VtParser::buildTable(true);
+inline constexpr VtParser::Table VtParser::C1_TABLE =
+    VtParser::buildTable(false);
+
+template <typename Performer>
+void VtParser::feed(std::string_view data, Performer &performer) {
+  const Table &t = *table;
+  const unsigned char *p = (const unsigned char *)data.data();
+  const unsigned char *end = p + data.size();
+
+  while (p < end) {
+    if (state == State::Ground) {
+      if (*p >= 0x20 && *p < 0x7F && !utf8.hasPending()) {
+        size_t run = scanPrintableAscii(p, end - p);
+        performer.vtPrintAscii((const char *)p, run);
+        p += run;
+        continue;
+      }
+      if (table == &UTF8_TABLE && (*p >= 0x80 || utf8.hasPending())) {
+        size_t run = scanText(p, end - p);
+        printUtf8(p, run, performer);
+        p += run;
+        // A control byte cuts a partial sequence short
+        if (p < end && utf8.flush())
+          performer.vtPrint(Utf8Decoder::REPLACEMENT);
+        if (run > 0)
+          continue;
+      }
+    }
+
+    unsigned char c = *p++;
+    Entry entry = t[(size_t)state][c];
+    Action action = (Action)((entry >> 4) & 0xF);
+
+    if (entry & TRANSITION) {
+      changeState((State)(entry & 0xF), c, action, performer);
+    } else {
+      perform(action, c, performer);
+    }
+  }
+}
+
+template <typename Performer>
+void VtParser::printUtf8(const unsigned char *data, size_t size,
+                         Performer &performer) {
+  uint32_t codepoints[UTF8_BATCH + 1];
+  while (size > 0) {
+    size_t batch = size < UTF8_BATCH ? size : UTF8_BATCH;
+    size_t count = utf8.decode(data, batch, codepoints);
+    for (size_t i = 0; i < count; i++)
+      performer.vtPrint(codepoints[i]);
+    data += batch;
+    size -= batch;
+  }
+}
+
+template <typename Performer>
+void VtParser::changeState(State next, uint8_t c, Action action,
+                           Performer &performer) {
+  // Exit action of the state we leave
+  if (state == State::OscString) {
+    performer.vtOscDispatch(oscData);
+  } else if (state == State::DcsPassthrough) {
+    performer.vtDcsUnhook();
+  }
+
+  perform(action, c, performer);
+  state = next;
+
+  // Entry action of the state we enter
+  switch (next) {
+  case State::Escape:
+  case State::CsiEntry:
+  case State::DcsEntry:
+    clear();
+    break;
+  case State::OscString:
+    oscData.clear();
+    break;
+  case State::DcsPassthrough:
+    performer.vtDcsHook(*this, c);
+    break;
+  default:
+    break;
+  }
+}
+
+template <typename Performer>
+void VtParser::perform(Action action, uint8_t c, Performer &performer) {
+  switch (action) {
+  case Action::Print:
+    performer.vtPrint(c);
+    break;
+  case Action::Execute:
+    performer.vtExecute(c);
+    break;
+  case Action::Collect:
+    collect(c);
+    break;
+  case Action::Param:
+    param(c);
+    break;
+  case Action::EscDispatch:
+    if (!intermediateOverflow)
+      performer.vtEscDispatch(*this, c);
+    break;
+  case Action::CsiDispatch:
+    if (!intermediateOverflow)
+      performer.vtCsiDispatch(*this, c);
+    break;
+  case Action::Put:
+    performer.vtDcsPut(c);
+    break;
+  case Action::OscPut:
+    if (oscData.size() < MAX_OSC_LENGTH)
+      oscData += (char)c;
+    break;
+  case Action::None:
+  case Action::Ignore:
+    break;
+  }
+}
@@ -2,18 +2,25 @@
 
 #include "Background.h"
 #include "FontManager.h"
+#include "FrameUniforms.h"
 #include "PTYHandler.h"
 #include "Renderer.h"
 #include "Shader.h"
+#include "ShaderCache.h"
 #include "Terminal.h"
+#include "TerminalView.h"
+#include <cstdio>
 
 // Global state
 Terminal *globalTerminal = nullptr;
+TerminalView *globalTerminalView = nullptr;
 PTYHandler *globalPTY = nullptr;
 bool vsyncEnabled = true;
+bool redrawRequested = true; // Set by callbacks that need a fresh frame
 
 void updatePTYSize(int width, int height);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
+void window_refresh_callback(GLFWwindow *window);
 void key_callback(GLFWwindow *window, int key, int scancode, int action,
                   int mods);
 void char_callback(GLFWwindow *window, unsigned int codepoint);
@@ -38,6 +45,7 @@ int main() {
   }
   glfwMakeContextCurrent(window);
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  glfwSetWindowRefreshCallback(window, window_refresh_callback);
   glfwSetKeyCallback(window, key_callback);
   glfwSetCharCallback(window, char_callback);
   glfwSetScrollCallback(window, scroll_callback);
@@ -60,38 +68,53 @@ int main() {
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+  // Linked programs are reused across launches when the driver allows it
+  ShaderCache::init();
+
   // Initialize Systems
   const char *vertexSource =
       "#version 330 core\n"
       "layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>\n"
+      "layout (location = 1) in uvec4 color; // <rgb 0-255, atlas layer>\n"
       "out vec2 TexCoords;\n"
+      "out vec3 TextColor;\n"
+      "flat out float Layer;\n"
       "\n"
-      "uniform mat4 projection;\n"
+      "layout (std140) uniform Frame {\n"
+      "    mat4 projection;\n"
+      "    vec2 viewport;\n"
+      "    float time;\n"
+      "};\n"
       "\n"
       "void main()\n"
       "{\n"
       "    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);\n"
       "    TexCoords = vertex.zw;\n"
+      "    TextColor = vec3(color.rgb) / 255.0;\n"
+      "    Layer = float(color.a);\n"
       "}\0";
 
   const char *fragmentSource =
       "#version 330 core\n"
       "in vec2 TexCoords;\n"
+      "in vec3 TextColor;\n"
+      "flat in float Layer;\n"
       "out vec4 color;\n"
       "\n"
-      "uniform sampler2D text;\n"
-      "uniform vec3 textColor;\n"
+      "uniform sampler2DArray text;\n"
       "\n"
       "void main()\n"
       "{    \n"
-      "    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);\n"
-      "    color = vec4(textColor, 1.0) * sampled;\n"
+      "    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, vec3(TexCoords, Layer)).r);\n"
+      "    color = vec4(TextColor, 1.0) * sampled;\n"
       "}\0";
 
   Shader shader(vertexSource, fragmentSource, true);
-  glm::mat4 projection = glm::ortho(0.0f, 800.0f, 0.0f, 600.0f);
   shader.use();
-  shader.setMat4("projection", &projection[0][0]);
+  shader.set(shader.uniform<int>("text"), 0);
+  // Projection and time for every shader, uploaded only when they change
+  FrameUniforms frameUniforms;
+  frameUniforms.setViewport(800.0f, 600.0f);
 
   Renderer renderer(shader);
   FontManager fontManager;
@@ -103,9 +126,15 @@ int main() {
 
   Terminal terminal(800.0f, 600.0f);
   globalTerminal = &terminal;
+  TerminalView terminalView(terminal);
+  globalTerminalView = &terminalView;
+  if (const char *instanced = getenv("TERMINALGL_INSTANCED"))
+    terminalView.setInstanced(atoi(instanced) != 0);
 
   PTYHandler pty;
   globalPTY = &pty;
+  // Wake the main loop out of glfwWaitEventsTimeout when the shell writes
+  pty.setOutputCallback([]() { glfwPostEmptyEvent(); });
 
   Background background;
   // Try to load a gif if it exists, otherwise warn
@@ -114,6 +143,28 @@ int main() {
               << std::endl;
   }
 
+  // Every program exists by now; compare with TERMINALGL_SHADER_CACHE=0
+  const ShaderCache::Stats &shaderStats = ShaderCache::getStats();
+  printf("Shaders: %d programs in %.1f ms (%d from cache%s)\n",
+         shaderStats.programs, shaderStats.milliseconds, shaderStats.cacheHits,
+         ShaderCache::isEnabled() ? "" : ", cache disabled");
+
+  // TERMINALGL_SPILL=<MB> keeps at most that much compressed scrollback in
+  // RAM and pages older history out to a temporary file (huge CI logs)
+  if (const char *spillMB = getenv("TERMINALGL_SPILL")) {
+    if (terminal.enableScrollbackSpill((size_t)(atof(spillMB) * 1e6))) {
+      std::cout << "Spilling scrollback beyond " << spillMB << " MB to disk"
+                << std::endl;
+    }
+  }
+
+  // TERMINALGL_RECORD=<file> captures all shell output for tools/replay.cpp
+  if (const char *recordPath = getenv("TERMINALGL_RECORD")) {
+    if (pty.startRecording(recordPath)) {
+      std::cout << "Recording session to " << recordPath << std::endl;
+    }
+  }
+
   if (pty.spawnShell()) {
     std::cout << "Shell spawned successfully" << std::endl;
     // Inject custom prompt command to override .zshrc/.bashrc
@@ -137,11 +188,70 @@ int main() {
   int frameCount = 0;
   float fpsTimer = 0.0f;
   std::string fpsText = "FPS: 0";
+  std::string memText = "MEM: 0 MB";
+
+  std::string windowTitle;
+
+  // Reused for every PTY read so ingest doesn't allocate in steady state
+  std::vector<char> ptyBuffer;
+
+  // Last framebuffer size the projection was built for
+  int lastWidth = 0;
+  int lastHeight = 0;
 
   while (!glfwWindowShouldClose(window)) {
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
+    frameUniforms.setTime(currentFrame);
+
+    // Poll PTY (the reader thread posts an empty event when data arrives)
+    std::string_view output = pty.readOutput(ptyBuffer);
+    if (!output.empty()) {
+      terminal.processOutput(output);
+
+      // OSC 0/2 from the shell or an application
+      if (terminal.getTitle() != windowTitle) {
+        windowTitle = terminal.getTitle();
+        glfwSetWindowTitle(window, windowTitle.c_str());
+      }
+    }
+
+    terminal.updateCursorBlink(deltaTime);
+    if (background.update(deltaTime)) {
+      redrawRequested = true;
+    }
+
+    int scrWidth, scrHeight;
+    glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
+
+    // Minimized: nothing to draw until the window comes back
+    if (scrWidth == 0 || scrHeight == 0) {
+      glfwWaitEvents();
+      continue;
+    }
+
+    // Update Projection (Handle Resize)
+    if (scrWidth != lastWidth || scrHeight != lastHeight) {
+      frameUniforms.setViewport((float)scrWidth, (float)scrHeight);
+
+      terminal.setSize((float)scrWidth, (float)scrHeight);
+      lastWidth = scrWidth;
+      lastHeight = scrHeight;
+      redrawRequested = true;
+    }
+
+    // Idle: sleep until input, PTY output or the next animation deadline
+    if (!redrawRequested && !terminal.needsRedraw()) {
+      double timeout = terminal.timeUntilCursorBlink();
+      float nextBackgroundFrame = background.timeUntilNextFrame();
+      if (nextBackgroundFrame >= 0.0f && nextBackgroundFrame < timeout)
+        timeout = nextBackgroundFrame;
+      glfwWaitEventsTimeout(timeout);
+      continue;
+    }
+    redrawRequested = false;
+    terminal.clearRedraw();
 
     // GPU Query Result Handling
     GLuint64 startTime = 0, stopTime = 0;
@@ -190,7 +300,8 @@ int main() {
 
     if (fpsTimer >= 1.0f) {
       fpsText = "FPS: " + std::to_string(frameCount) +
-                (vsyncEnabled ? " (VSync)" : " (Uncapped)");
+                (vsyncEnabled ? " (VSync)" : " (Uncapped)") +
+                (terminalView.isInstanced() ? " [instanced]" : "");
 
       // Calculate Average GPU Usage
       if (accumulatedFrameTime > 0.0) {
@@ -201,6 +312,11 @@ int main() {
         gpuUsage = 0.0;
       }
 
+      char mem[32];
+      snprintf(mem, sizeof(mem), "MEM: %.1f MB",
+               terminal.getGrid().memoryUsage() / 1e6);
+      memText = mem;
+
       // Reset
       frameCount = 0;
       fpsTimer = 0.0f;
@@ -208,39 +324,13 @@ int main() {
       accumulatedFrameTime = 0.0;
     }
 
-    // Poll PTY
-    std::string output = pty.readOutput();
-    if (!output.empty()) {
-      terminal.processOutput(output);
-    }
-
-    // Update Projection (Handle Resize)
-    int scrWidth, scrHeight;
-    glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
-
-    // Check minimize
-    if (scrWidth == 0 || scrHeight == 0) {
-      glfwPollEvents();
-      continue;
-    }
-
-    glm::mat4 projection =
-        glm::ortho(0.0f, (float)scrWidth, 0.0f, (float)scrHeight);
-    shader.use();
-    shader.setMat4("projection", &projection[0][0]);
-
-    // Update terminal size if needed (might be redundant if callback does it,
-    // but safe)
-    if (globalTerminal) {
-      globalTerminal->setSize((float)scrWidth, (float)scrHeight);
-    }
-
     // Render
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    background.render(deltaTime);
-    terminal.render(renderer, fontManager, deltaTime);
+    background.render();
+    renderer.begin(fontManager);
+    terminalView.render(renderer, fontManager);
 
     glEndQuery(GL_TIME_ELAPSED);
     std::swap(queryBack, queryFront);
@@ -256,6 +346,16 @@ int main() {
     std::string gpuText = "GPU: " + std::to_string((int)gpuUsage) + "%";
     renderer.drawText(fontManager, gpuText, textX, (float)scrHeight - 60.0f,
                       1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    renderer.drawText(fontManager, memText, textX, (float)scrHeight - 90.0f,
+                      1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    // Last frame's vertex uploads: stall-free / total, orphaned buffers
+    const StreamBuffer::Stats &uploads = renderer.getUploadStats();
+    char vbo[48];
+    snprintf(vbo, sizeof(vbo), "VBO: %zu/%zu (%zu orph)", uploads.stallFree,
+             uploads.uploads, uploads.orphaned);
+    renderer.drawText(fontManager, vbo, textX, (float)scrHeight - 120.0f,
+                      1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    renderer.end();
 
     glfwSwapBuffers(window);
     glfwPollEvents();
@@ -291,8 +391,11 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     globalTerminal->setSize(width, height);
   }
   updatePTYSize(width, height);
+  redrawRequested = true;
 }
 
+void window_refresh_callback(GLFWwindow *window) { redrawRequested = true; }
+
 void key_callback(GLFWwindow *window, int key, int scancode, int action,
                   int mods) {
   if (globalTerminal && globalPTY) {
@@ -310,10 +413,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action,
       if (key == GLFW_KEY_V && (mods & GLFW_MOD_SUPER)) {
         const char *clipboard = glfwGetClipboardString(window);
         if (clipboard) {
-          globalPTY->writeInput(clipboard);
-        }
-        if (clipboard) {
-          globalPTY->writeInput(clipboard);
+          globalPTY->pasteInput(clipboard, globalTerminal->isBracketedPaste());
         }
         return;
       }
@@ -322,6 +422,14 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action,
       if (key == GLFW_KEY_F3) {
         vsyncEnabled = !vsyncEnabled;
         glfwSwapInterval(vsyncEnabled ? 1 : 0);
+        redrawRequested = true;
+        return;
+      }
+
+      // Instanced grid renderer toggle (F4)
+      if (key == GLFW_KEY_F4) {
+        globalTerminalView->setInstanced(!globalTerminalView->isInstanced());
+        redrawRequested = true;
         return;
       }
 
@@ -352,7 +460,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action,
         return;
       }
     }
-    globalTerminal->handleInput(key, action, mods, *globalPTY);
+    globalTerminalView->handleInput(key, action, mods, *globalPTY);
   }
 }
 
@@ -1,11 +1,20 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
+layout (location = 1) in uvec4 color; // <rgb 0-255, atlas layer>
 out vec2 TexCoords;
+out vec3 TextColor;
+flat out float Layer;
 
-uniform mat4 projection;
+layout (std140) uniform Frame {
+    mat4 projection;
+    vec2 viewport;
+    float time;
+};
 
 void main()
 {
     gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
     TexCoords = vertex.zw;
+    TextColor = vec3(color.rgb) / 255.0;
+    Layer = float(color.a);
 }
@@ -0,0 +1,181 @@
+#include "../src/Grid.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+void expect(bool condition, const std::string &what) {
+  if (!condition) {
+    std::cout << "TEST FAILED: " << what << std::endl;
+    exit(1);
+  }
+}
+
+// Writes the line number as the first cell so lines can be identified
+void stamp(Grid &grid, size_t line, uint32_t value) {
+  Cell *cells = grid.rowCells(line);
+  cells[0] = Grid::BLANK;
+  cells[0].codepoint = value;
+  grid.setLength(line, 1);
+}
+
+void test_ring() {
+  std::cout << "Starting ring test..." << std::endl;
+  Grid grid(80, 100);
+  expect(grid.size() == 1, "starts with one line");
+  stamp(grid, 0, 0);
+
+  for (uint32_t i = 1; i < 100; i++) {
+    expect(!grid.pushLine(), "no drop while filling");
+    stamp(grid, grid.size() - 1, i);
+  }
+  size_t memory = grid.memoryUsage();
+
+  // Full: every new line drops the oldest and reuses its storage
+  for (uint32_t i = 100; i < 1050; i++) {
+    expect(grid.pushLine(), "drop once full");
+    expect(grid[grid.size() - 1].empty(), "recycled line is blank");
+    stamp(grid, grid.size() - 1, i);
+  }
+  expect(grid.size() == 100, "bounded line count");
+  expect(grid.memoryUsage() == memory, "bounded memory");
+  for (size_t line = 0; line < grid.size(); line++)
+    expect(grid[line][0].codepoint == 950 + line, "logical order");
+}
+
+void test_truncate_and_clear() {
+  std::cout << "Starting truncate/clear test..." << std::endl;
+  Grid grid(10, 5);
+  Cell *cells = grid.rowCells(0);
+  for (int i = 0; i < 10; i++)
+    cells[i].codepoint = 'a' + i;
+  grid.setLength(0, 10);
+  grid.setWrapped(0, true);
+
+  grid.truncate(0, 4);
+  expect(grid[0].size() == 4 && !grid.isWrapped(0), "truncated");
+  expect(grid.rowCells(0)[4].codepoint == ' ', "cleared cells are blank");
+
+  grid.pushLine();
+  grid.clear();
+  expect(grid.size() == 1 && grid[0].empty(), "cleared");
+}
+
+void test_resize() {
+  std::cout << "Starting resize test..." << std::endl;
+  Grid grid(10, 10);
+  for (uint32_t i = 0; i < 25; i++) {
+    if (i > 0)
+      grid.pushLine();
+    Cell *cells = grid.rowCells(grid.size() - 1);
+    for (int c = 0; c < 10; c++)
+      cells[c].codepoint = i;
+    grid.setLength(grid.size() - 1, 10);
+  }
+
+  // Narrower and shorter: the newest lines survive, cut to the new width
+  uint64_t id = grid.getLineId(grid.size() - 1);
+  grid.resize(4, 6);
+  expect(grid.size() == 6 && grid.getColumns() == 4, "resized");
+  expect(grid.getLineId(5) == id, "line ids survive a resize");
+  expect(grid[0][0].codepoint == 19 && grid[5][3].codepoint == 24,
+         "newest lines kept");
+  expect(grid[0].size() == 4, "length clamped");
+
+  // Wider: existing cells kept, new columns blank
+  grid.resize(12, 6);
+  expect(grid[5].size() == 4 && grid.rowCells(5)[11].codepoint == ' ',
+         "widened");
+  grid.pushLine();
+  expect(grid.size() == 6 && grid[0][0].codepoint == 20, "ring after resize");
+}
+
+void test_history() {
+  std::cout << "Starting history test..." << std::endl;
+  // 10 hot lines; everything older moves to compressed pages
+  const size_t lines = 3000;
+  Grid grid(20, 2000, 10);
+  for (uint32_t i = 0; i < lines; i++) {
+    if (i > 0)
+      grid.pushLine();
+    size_t line = grid.size() - 1;
+    Cell *cells = grid.rowCells(line);
+    for (uint32_t c = 0; c < i % 20; c++) {
+      cells[c].codepoint = c == 0 ? i : 0x4E00 + c;
+      cells[c].attributes = (i / 7) % 2 ? ATTR_BOLD : 0;
+      cells[c].fg = (uint16_t)(i % 300);
+    }
+    grid.setLength(line, i % 20);
+    grid.setWrapped(line, i % 3 == 0);
+  }
+  grid.waitForCompression();
+
+  expect(grid.size() == 2000, "bounded with history");
+  expect(grid.getFirstHotLine() >= 2000 - 10 - Scrollback::PAGE_LINES,
+         "hot ring stays small");
+  for (size_t line = 0; line < grid.size(); line++) {
+    uint32_t i = (uint32_t)(lines - grid.size() + line);
+    Grid::Row row = grid[line];
+    expect(row.size() == i % 20, "history length");
+    expect(grid.isWrapped(line) == (i % 3 == 0), "history wrap flag");
+    for (uint32_t c = 0; c < row.size(); c++) {
+      const Cell &cell = row[c];
+      expect(cell.codepoint == (c == 0 ? i : 0x4E00 + c), "history text");
+      expect(cell.attributes == ((i / 7) % 2 ? ATTR_BOLD : 0u) &&
+                 cell.fg == i % 300 && cell.bg == COLOR_DEFAULT_BG,
+             "history style");
+    }
+  }
+
+  Grid::MemoryStats stats = grid.getMemoryStats();
+  expect(stats.scrollback.pendingBytes == 0, "all pages compressed");
+  // Lines average under 10 cells
+  expect(stats.scrollback.compressedBytes <
+             grid.getFirstHotLine() * 10 * sizeof(Cell) / 2,
+         "history smaller than raw cells");
+
+  grid.clear();
+  expect(grid.size() == 1 && grid.getFirstHotLine() == 0, "history cleared");
+}
+
+void test_generations() {
+  std::cout << "Starting generation test..." << std::endl;
+  Grid grid(10, 3);
+  grid.pushLine();
+  uint64_t first = grid.getGeneration(0);
+  uint64_t second = grid.getGeneration(1);
+
+  (void)grid[0];
+  (void)grid.isWrapped(0);
+  expect(grid.getGeneration(0) == first, "reads don't change a line");
+  grid.rowCells(0)[0].codepoint = 'x';
+  expect(grid.getGeneration(0) != first, "cell access marks the line");
+  first = grid.getGeneration(0);
+  grid.setLength(0, 1);
+  expect(grid.getGeneration(0) != first, "length change");
+  first = grid.getGeneration(0);
+  grid.truncate(0, 5);
+  expect(grid.getGeneration(0) == first, "no-op truncate");
+  grid.truncate(0, 0);
+  expect(grid.getGeneration(0) != first, "truncate");
+  expect(grid.getGeneration(1) == second, "other lines untouched");
+
+  // Ids follow the line as older ones are dropped
+  uint64_t id = grid.getLineId(1);
+  grid.pushLine();
+  grid.pushLine();
+  expect(grid.getLineId(0) == id, "stable line id");
+  uint64_t newest = grid.getLineId(2);
+  grid.clear();
+  expect(grid.getLineId(0) > newest, "cleared lines get new ids");
+}
+
+int main() {
+  setbuf(stdout, NULL);
+  test_ring();
+  test_truncate_and_clear();
+  test_resize();
+  test_history();
+  test_generations();
+  std::cout << "TEST PASSED" << std::endl;
+  return 0;
+}
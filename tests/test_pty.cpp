@@ -19,7 +19,8 @@ void test_shell_interaction() {
   // Give it a moment to initialize prompt
   std::cout << "Waiting for prompt..." << std::endl;
   std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-  std::string initial = pty.readOutput();
+  std::vector<char> buffer;
+  std::string initial(pty.readOutput(buffer));
   std::cout << "Initial output (" << initial.length() << " bytes)."
             << std::endl;
   // Print safely
@@ -41,7 +42,7 @@ void test_shell_interaction() {
   std::cout << "Listening for response..." << std::endl;
   for (int i = 0; i < 20; i++) {
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
-    std::string chunk = pty.readOutput();
+    std::string chunk(pty.readOutput(buffer));
     if (!chunk.empty()) {
       std::cout << "Chunk: '" << chunk << "'" << std::endl;
       accumulated_output += chunk;
@@ -62,8 +63,60 @@ void test_shell_interaction() {
   }
 }
 
+void test_large_input() {
+  std::cout << "Starting PTY Large Input Test..." << std::endl;
+
+  PTYHandler pty;
+  if (!pty.spawnShell()) {
+    std::cerr << "Failed to spawn shell!" << std::endl;
+    exit(1);
+  }
+
+  // Count what arrives on the other side without echoing it back
+  pty.writeInput("stty -echo; wc -c\n");
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  // 2 MB in 100-byte lines (canonical mode caps a single line)
+  std::string line(99, 'x');
+  line += '\n';
+  std::string payload;
+  for (int i = 0; i < 20000; i++)
+    payload += line;
+  pty.writeInput(payload);
+  std::cout << "Queued " << payload.size() << " bytes, "
+            << pty.getPendingInput() << " pending." << std::endl;
+
+  std::vector<char> buffer;
+  std::string accumulated_output = "";
+  for (int i = 0; i < 100 && pty.getPendingInput() > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    accumulated_output += std::string(pty.readOutput(buffer));
+  }
+  if (pty.getPendingInput() > 0) {
+    std::cout << "TEST FAILED: Input queue never drained." << std::endl;
+    exit(1);
+  }
+
+  pty.writeInput("\x04"); // EOF for wc
+  for (int i = 0; i < 20; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    accumulated_output += std::string(pty.readOutput(buffer));
+    if (accumulated_output.find("2000000") != std::string::npos)
+      break;
+  }
+
+  if (accumulated_output.find("2000000") != std::string::npos) {
+    std::cout << "TEST PASSED" << std::endl;
+  } else {
+    std::cout << "TEST FAILED: wc did not see every byte. Output:\n"
+              << accumulated_output << std::endl;
+    exit(1);
+  }
+}
+
 int main() {
   setbuf(stdout, NULL);
   test_shell_interaction();
+  test_large_input();
   return 0;
 }
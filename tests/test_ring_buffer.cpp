@@ -0,0 +1,117 @@
+#include "../src/RingBuffer.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+void test_wraparound() {
+  std::cout << "Starting wraparound test..." << std::endl;
+
+  SpscRingBuffer ring(8);
+  char out[16];
+
+  // Fill, partially drain, then write across the end of the storage
+  if (ring.write("abcdefgh", 8) != 8 || ring.write("x", 1) != 0) {
+    std::cout << "TEST FAILED: Capacity not respected." << std::endl;
+    exit(1);
+  }
+  ring.read(out, 5);
+  if (ring.write("12345", 5) != 5) {
+    std::cout << "TEST FAILED: Could not write after drain." << std::endl;
+    exit(1);
+  }
+
+  size_t n = ring.read(out, sizeof(out));
+  if (std::string(out, n) != "fgh12345") {
+    std::cout << "TEST FAILED: Got '" << std::string(out, n) << "'"
+              << std::endl;
+    exit(1);
+  }
+  std::cout << "Wraparound OK" << std::endl;
+}
+
+void test_write_regions() {
+  std::cout << "Starting zero-copy region test..." << std::endl;
+
+  SpscRingBuffer ring(8);
+  char out[16];
+  ring.write("abcdef", 6);
+  ring.read(out, 4);
+
+  // Free space now wraps: 2 bytes at the end, 4 at the start
+  char *first, *second;
+  size_t firstLen, secondLen;
+  size_t space = ring.writeRegions(first, firstLen, second, secondLen);
+  if (space != 6 || firstLen != 2 || secondLen != 4) {
+    std::cout << "TEST FAILED: Bad regions " << firstLen << "+" << secondLen
+              << std::endl;
+    exit(1);
+  }
+  memcpy(first, "\0x", 2);
+  memcpy(second, "yz", 2);
+  ring.commitWrite(4);
+
+  // Embedded NUL bytes must survive the trip
+  size_t n = ring.read(out, sizeof(out));
+  if (std::string(out, n) != std::string("ef\0xyz", 6)) {
+    std::cout << "TEST FAILED: Region data corrupted." << std::endl;
+    exit(1);
+  }
+  std::cout << "Regions OK" << std::endl;
+}
+
+void test_threaded_stream() {
+  std::cout << "Starting threaded stream test..." << std::endl;
+
+  SpscRingBuffer ring(4096);
+  const size_t total = 8 * 1024 * 1024;
+
+  std::thread producer([&]() {
+    char chunk[1000];
+    size_t sent = 0;
+    while (sent < total) {
+      size_t len = sizeof(chunk);
+      if (len > total - sent)
+        len = total - sent;
+      for (size_t i = 0; i < len; i++)
+        chunk[i] = (char)((sent + i) % 251);
+
+      size_t written = 0;
+      while (written < len) {
+        size_t n = ring.write(chunk + written, len - written);
+        if (n == 0)
+          std::this_thread::yield(); // Full: let the consumer run
+        written += n;
+      }
+      sent += len;
+    }
+  });
+
+  char buffer[777];
+  size_t received = 0;
+  while (received < total) {
+    size_t n = ring.read(buffer, sizeof(buffer));
+    if (n == 0)
+      std::this_thread::yield(); // Empty: let the producer run
+    for (size_t i = 0; i < n; i++) {
+      if (buffer[i] != (char)((received + i) % 251)) {
+        std::cout << "TEST FAILED: Corrupt byte at " << received + i
+                  << std::endl;
+        exit(1);
+      }
+    }
+    received += n;
+  }
+  producer.join();
+
+  std::cout << "Streamed " << received << " bytes OK" << std::endl;
+}
+
+int main() {
+  setbuf(stdout, NULL);
+  test_wraparound();
+  test_write_regions();
+  test_threaded_stream();
+  std::cout << "TEST PASSED" << std::endl;
+  return 0;
+}
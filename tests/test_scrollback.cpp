@@ -0,0 +1,132 @@
+#include "../src/Lz4.h"
+#include "../src/Scrollback.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+void expect(bool condition, const std::string &what) {
+  if (!condition) {
+    std::cout << "TEST FAILED: " << what << std::endl;
+    exit(1);
+  }
+}
+
+bool roundTrip(const std::vector<uint8_t> &data, size_t &compressedSize) {
+  std::vector<uint8_t> compressed(lz4CompressBound(data.size()));
+  compressedSize = lz4Compress(data.data(), data.size(), compressed.data());
+  std::vector<uint8_t> out(data.size());
+  return lz4Decompress(compressed.data(), compressedSize, out.data(),
+                       out.size()) &&
+         out == data;
+}
+
+void test_lz4() {
+  std::cout << "Starting LZ4 test..." << std::endl;
+  size_t size;
+  expect(roundTrip({}, size), "empty");
+  expect(roundTrip({'a', 'b', 'c'}, size), "shorter than a match");
+
+  std::string text;
+  for (int i = 0; i < 2000; i++)
+    text += "user@host:~$ ls -la " + std::to_string(i % 37) + "\n";
+  std::vector<uint8_t> repetitive(text.begin(), text.end());
+  expect(roundTrip(repetitive, size), "repetitive text");
+  expect(size < repetitive.size() / 4, "repetitive text compresses");
+
+  std::vector<uint8_t> noise(100000);
+  uint32_t seed = 12345;
+  for (uint8_t &byte : noise) {
+    seed = seed * 1103515245 + 12345;
+    byte = (uint8_t)(seed >> 16);
+  }
+  expect(roundTrip(noise, size), "incompressible data");
+  expect(size <= lz4CompressBound(noise.size()), "within bound");
+
+  // Corrupt input is rejected, never written past the output
+  std::vector<uint8_t> compressed(lz4CompressBound(repetitive.size()));
+  size = lz4Compress(repetitive.data(), repetitive.size(), compressed.data());
+  std::vector<uint8_t> out(repetitive.size());
+  expect(!lz4Decompress(compressed.data(), size / 2, out.data(), out.size()),
+         "truncated input");
+  expect(!lz4Decompress(compressed.data(), size, out.data(), out.size() - 1),
+         "output too small");
+}
+
+// Page of count lines, line i holding i % 5 copies of first + i
+void pushLines(Scrollback &history, uint32_t first, size_t count) {
+  std::vector<Cell> cells;
+  std::vector<Scrollback::LineInfo> lines(count);
+  for (size_t i = 0; i < count; i++) {
+    lines[i].length = (uint16_t)(i % 5);
+    for (size_t c = 0; c < i % 5; c++)
+      cells.push_back(
+          Cell{first + (uint32_t)i, 0, COLOR_DEFAULT_FG, COLOR_DEFAULT_BG});
+  }
+  history.pushPage(std::move(cells), std::move(lines));
+}
+
+void test_pages() {
+  std::cout << "Starting page test..." << std::endl;
+  Scrollback history;
+  for (uint32_t page = 0; page < 20; page++)
+    pushLines(history, page * 100, 100);
+  expect(history.size() == 2000, "line count");
+
+  // Readable both before and after the worker gets to a page
+  Scrollback::LineInfo info;
+  expect(history.getLine(1999, info)[0].codepoint == 1999, "newest line");
+  history.waitForCompression();
+  expect(history.getStats().pendingBytes == 0, "compressed");
+
+  history.dropOldest(250);
+  expect(history.size() == 1750 && history.getStats().pages == 18,
+         "dropped whole pages only");
+  for (size_t line = 0; line < history.size(); line += 7) {
+    const Cell *cells = history.getLine(line, info);
+    uint32_t expected = (uint32_t)(line + 250);
+    expect(info.length == expected % 100 % 5, "length after drop");
+    for (size_t c = 0; c < info.length; c++)
+      expect(cells[c].codepoint == expected, "text after drop");
+  }
+  expect(history.getStats().cacheBytes > 0, "pages cached");
+
+  history.clear();
+  expect(history.size() == 0 && history.getStats().total() == 0, "cleared");
+}
+
+void test_spill() {
+  std::cout << "Starting spill test..." << std::endl;
+  Scrollback history;
+  for (uint32_t page = 0; page < 5; page++)
+    pushLines(history, page * 100, 100);
+  history.waitForCompression();
+  // A zero budget spills every packed page, including those packed already
+  expect(history.enableSpill(0), "spill file created");
+  for (uint32_t page = 5; page < 20; page++)
+    pushLines(history, page * 100, 100);
+  history.waitForCompression();
+
+  Scrollback::Stats stats = history.getStats();
+  expect(stats.spilledPages == 20 && stats.spilledBytes > 0, "all spilled");
+  expect(stats.compressedBytes < 20 * 256, "only bookkeeping in RAM");
+
+  history.dropOldest(150);
+  Scrollback::LineInfo info;
+  for (size_t line = 0; line < history.size(); line++) {
+    const Cell *cells = history.getLine(line, info);
+    uint32_t expected = (uint32_t)(line + 150);
+    expect(info.length == expected % 100 % 5, "spilled length");
+    for (size_t c = 0; c < info.length; c++)
+      expect(cells[c].codepoint == expected, "spilled text");
+  }
+  expect(history.getStats().spilledPages == 19, "dropped spilled page");
+}
+
+int main() {
+  setbuf(stdout, NULL);
+  test_lz4();
+  test_pages();
+  test_spill();
+  std::cout << "TEST PASSED" << std::endl;
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "../src/SessionRecording.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+void test_round_trip() {
+  std::cout << "Starting recording round-trip test..." << std::endl;
+
+  const char *path = "test_session.rec";
+  std::string binary("nul\0byte\x1b[0m", 12);
+  std::string large(100000, 'x');
+
+  SessionRecorder recorder;
+  if (!recorder.open(path)) {
+    std::cout << "TEST FAILED: Could not open recording." << std::endl;
+    exit(1);
+  }
+  recorder.record("hello\r\n", 0);
+  recorder.record(binary, 1500);
+  recorder.record(large, 300000000); // 5 minutes in
+  recorder.close();
+
+  SessionReplay replay;
+  if (!replay.load(path)) {
+    std::cout << "TEST FAILED: Could not load recording." << std::endl;
+    exit(1);
+  }
+  remove(path);
+
+  const auto &chunks = replay.getChunks();
+  if (chunks.size() != 3 || chunks[0].data != "hello\r\n" ||
+      chunks[1].data != binary || chunks[2].data != large) {
+    std::cout << "TEST FAILED: Chunk data mismatch." << std::endl;
+    exit(1);
+  }
+  if (chunks[0].timestampUs != 0 || chunks[1].timestampUs != 1500 ||
+      chunks[2].timestampUs != 300000000) {
+    std::cout << "TEST FAILED: Timestamp mismatch." << std::endl;
+    exit(1);
+  }
+  if (replay.getTotalBytes() != 7 + binary.size() + large.size()) {
+    std::cout << "TEST FAILED: Byte count mismatch." << std::endl;
+    exit(1);
+  }
+  std::cout << "Round trip OK" << std::endl;
+}
+
+int main() {
+  setbuf(stdout, NULL);
+  test_round_trip();
+  std::cout << "TEST PASSED" << std::endl;
+  return 0;
+}
@@ -0,0 +1,324 @@
+#include "../src/Terminal.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counts heap allocations so tests can assert a path doesn't allocate
+static size_t allocationCount = 0;
+
+void *operator new(size_t size) {
+  allocationCount++;
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Text of one buffer line, trailing blanks trimmed
+std::string lineText(const Terminal &terminal, int row) {
+  const auto &lines = terminal.getGrid();
+  if (row < 0 || row >= (int)lines.size())
+    return "";
+  std::string text;
+  for (const auto &glyph : lines[row])
+    text += (char)glyph.codepoint;
+  while (!text.empty() && text.back() == ' ')
+    text.pop_back();
+  return text;
+}
+
+void expect(bool condition, const std::string &what) {
+  if (!condition) {
+    std::cout << "TEST FAILED: " << what << std::endl;
+    exit(1);
+  }
+}
+
+void test_plain_text() {
+  std::cout << "Starting plain text test..." << std::endl;
+  Terminal terminal(800.0f, 600.0f);
+  terminal.processOutput("hello\r\nworld");
+  expect(lineText(terminal, 0) == "hello", "first line");
+  expect(lineText(terminal, 1) == "world", "second line");
+  expect(terminal.getCursorX() == 5 && terminal.getCursorY() == 1,
+         "cursor after text");
+
+  terminal.processOutput("\rW\bX");
+  expect(lineText(terminal, 1) == "Xorld", "carriage return/backspace");
+}
+
+void test_csi() {
+  std::cout << "Starting CSI test..." << std::endl;
+  Terminal terminal(800.0f, 600.0f);
+
+  terminal.processOutput("abcdef\x1b[3D\x1b[K");
+  expect(lineText(terminal, 0) == "abc", "cursor left + erase line");
+
+  terminal.processOutput("\x1b[31mR\x1b[0mW");
+  const auto &line = terminal.getGrid()[0];
+  expect(terminal.resolveColor(line[3].fg) == Terminal::Color{1, 0, 0},
+         "SGR 31 is red");
+  expect(line[4].fg == COLOR_DEFAULT_FG, "SGR 0 resets");
+
+  terminal.processOutput("\x1b[2J\x1b[1;1Htop");
+  expect(lineText(terminal, 0) == "top", "clear + home");
+
+  expect(!terminal.isBracketedPaste(), "bracketed paste off by default");
+  terminal.processOutput("\x1b[?2004h");
+  expect(terminal.isBracketedPaste(), "DECSET 2004");
+  terminal.processOutput("\x1b[?2004l");
+  expect(!terminal.isBracketedPaste(), "DECRST 2004");
+}
+
+// Records the parameters of the last CSI sequence
+struct ParamRecorder {
+  std::vector<int> params;
+  std::vector<bool> subParams;
+  char finalByte = 0;
+
+  void vtPrint(uint32_t c) {}
+  void vtPrintAscii(const char *text, size_t length) {}
+  void vtExecute(uint8_t c) {}
+  void vtEscDispatch(const VtParser &parser, uint8_t c) {}
+  void vtCsiDispatch(const VtParser &parser, uint8_t c) {
+    params.clear();
+    subParams.clear();
+    for (size_t i = 0; i < parser.getParamCount(); i++) {
+      params.push_back(parser.getParam(i));
+      subParams.push_back(parser.isSubParam(i));
+    }
+    finalByte = (char)c;
+  }
+  void vtOscDispatch(std::string_view data) {}
+  void vtDcsHook(const VtParser &parser, uint8_t c) {}
+  void vtDcsPut(uint8_t c) {}
+  void vtDcsUnhook() {}
+};
+
+void test_csi_params() {
+  std::cout << "Starting CSI parameter test..." << std::endl;
+  VtParser parser;
+  ParamRecorder recorder;
+
+  parser.feed("\x1b[m", recorder);
+  expect(recorder.params.empty() && recorder.finalByte == 'm', "no params");
+
+  parser.feed("\x1b[;5;H", recorder);
+  expect(recorder.params == std::vector<int>({0, 5, 0}), "empty params");
+
+  parser.feed("\x1b[38:2::255:128:0m", recorder);
+  expect(recorder.params == std::vector<int>({38, 2, 0, 255, 128, 0}),
+         "colon sub-parameters");
+  expect(recorder.subParams ==
+             std::vector<bool>({false, true, true, true, true, true}),
+         "sub-parameter marks");
+
+  parser.feed("\x1b[99999999999A", recorder);
+  expect(recorder.params == std::vector<int>({VtParser::MAX_PARAM_VALUE}),
+         "value clamped");
+
+  std::string many = "\x1b[";
+  for (int i = 1; i <= 40; i++)
+    many += std::to_string(i) + ";";
+  parser.feed(many + "m", recorder);
+  expect(recorder.params.size() == VtParser::MAX_PARAMS &&
+             recorder.params.back() == (int)VtParser::MAX_PARAMS,
+         "extra params dropped");
+
+  // Extended colors: their arguments aren't SGR codes (31 is not red here)
+  Terminal terminal(800.0f, 600.0f);
+  terminal.processOutput("\x1b[38;5;31mA\x1b[38:5:31mB\x1b[0;32mC");
+  const auto &line = terminal.getGrid()[0];
+  expect(line[0].fg == 31 && line[0].attributes == 0, "38;5;31");
+  expect(line[1].fg == 31 && line[1].attributes == 0, "38:5:31");
+  expect(line[2].fg == 2, "0;32 is green");
+
+  // Escape sequences on an existing line don't touch the heap
+  std::string sequences =
+      "\x1b[1;31m\x1b[0m\x1b[38;5;208m\x1b[5C\x1b[3D\x1b[K\x1b[2;4H"
+      "\x1b[?2004h\x1b[?2004l\x1b[38:2::1:2:3m";
+  terminal.processOutput(sequences);
+  size_t before = allocationCount;
+  for (int i = 0; i < 100; i++)
+    terminal.processOutput(sequences);
+  size_t allocations = allocationCount - before;
+  expect(allocations == 0, "CSI sequences allocate");
+}
+
+void test_sgr() {
+  std::cout << "Starting SGR test..." << std::endl;
+  Terminal terminal(800.0f, 600.0f);
+
+  terminal.processOutput("\x1b[1;4;7;41;93mA\x1b[22;27mB\x1b[24;39;49mC");
+  Grid::Row line = terminal.getGrid()[0];
+  expect(line[0].attributes == (ATTR_BOLD | ATTR_UNDERLINE | ATTR_INVERSE),
+         "attributes set");
+  expect(line[0].fg == 11 && line[0].bg == 1, "bright fg, normal bg");
+  expect(line[1].attributes == ATTR_UNDERLINE, "attributes cleared");
+  expect(line[2].attributes == 0 && line[2].fg == COLOR_DEFAULT_FG &&
+             line[2].bg == COLOR_DEFAULT_BG,
+         "default colors");
+
+  // Truecolor: both forms, interned to one table entry
+  terminal.processOutput("\x1b[38;2;255;128;0mD\x1b[38:2::255:128:0mE"
+                         "\x1b[48:2:0:0:255mF\x1b[38;5;232mG");
+  line = terminal.getGrid()[0];
+  expect(line[3].fg >= TRUECOLOR_BASE && line[3].fg == line[4].fg,
+         "truecolor interned");
+  expect(terminal.resolveColor(line[3].fg) ==
+             Terminal::Color{1.0f, 128 / 255.0f, 0.0f},
+         "truecolor value");
+  expect(terminal.resolveColor(line[5].bg) == Terminal::Color{0, 0, 1},
+         "truecolor without color space id");
+  expect(line[5].fg == line[4].fg, "48 leaves fg alone");
+  expect(terminal.resolveColor(line[6].fg) ==
+             Terminal::Color{8 / 255.0f, 8 / 255.0f, 8 / 255.0f},
+         "grayscale ramp");
+}
+
+void test_string_sequences() {
+  std::cout << "Starting OSC/DCS test..." << std::endl;
+  Terminal terminal(800.0f, 600.0f);
+
+  // OSC (BEL and ST terminated), DCS and an unsupported CSI must not print
+  terminal.processOutput("\x1b]0;my title\x07"
+                         "a\x1b]2;other\x1b\\b");
+  terminal.processOutput("\x1bP1$r0m\x1b\\c\x1b[>4;1md\x1b(Be");
+  expect(lineText(terminal, 0) == "abcde", "string sequences swallowed");
+  expect(terminal.getTitle() == "other", "OSC 2 sets title");
+
+  // '>' marker must not be treated as SGR
+  expect(terminal.getGrid()[0][3].fg == COLOR_DEFAULT_FG,
+         "CSI > m ignored");
+
+  terminal.processOutput("\r\tX\tY");
+  expect(lineText(terminal, 0) == "abcde   X       Y", "tab stops");
+}
+
+void test_split_sequences() {
+  std::cout << "Starting split sequence test..." << std::endl;
+
+  // Escape sequences cut across read() chunks must parse the same
+  std::string stream = "one\x1b[32mtwo\x1b[0m\r\nthree\x1b[2Dee";
+  Terminal whole(800.0f, 600.0f);
+  whole.processOutput(stream);
+
+  Terminal split(800.0f, 600.0f);
+  for (char c : stream)
+    split.processOutput(std::string(1, c));
+
+  expect(whole.gridHash() == split.gridHash(), "byte-at-a-time hash");
+}
+
+void test_ascii_runs() {
+  std::cout << "Starting ASCII run test..." << std::endl;
+
+  // Control bytes at every offset of a 32-byte block must end the fast path
+  // in the right place; compare against byte-at-a-time feeding, which never
+  // sees a run longer than one byte
+  std::string stream;
+  for (int i = 0; i < 40; i++) {
+    stream += std::string(i, 'a' + i % 26);
+    stream += i % 3 ? "\r\n" : "\x1b[31m|\x1b[0m\n\r";
+    stream += std::string(70 - i, '~');
+    stream += "\x7f\r\n";
+  }
+  Terminal whole(800.0f, 600.0f);
+  whole.processOutput(stream);
+
+  Terminal split(800.0f, 600.0f);
+  for (char c : stream)
+    split.processOutput(std::string(1, c));
+
+  expect(whole.gridHash() == split.gridHash(), "ASCII run hash");
+  expect(lineText(whole, 1) == std::string(70, '~'), "ASCII run text");
+  expect(lineText(whole, 2) == "b", "ASCII run after CRLF");
+}
+
+void test_autowrap_and_scrollback() {
+  std::cout << "Starting autowrap/scrollback test..." << std::endl;
+  // 10 columns, 4 rows, 6 lines of scrollback
+  Terminal terminal(10 * 11.0f, 4 * 20.0f, 6);
+
+  terminal.processOutput("0123456789abc\r\n");
+  expect(lineText(terminal, 0) == "0123456789", "full row");
+  expect(lineText(terminal, 1) == "abc", "wrapped remainder");
+  expect(terminal.getGrid().isWrapped(0), "wrap flag");
+
+  // Exactly full row + CRLF: no blank line in between (deferred wrap)
+  terminal.processOutput("ABCDEFGHIJ\r\nnext");
+  expect(lineText(terminal, 2) == "ABCDEFGHIJ", "exact fit");
+  expect(lineText(terminal, 3) == "next", "no extra line");
+
+  // Select across the wrap: joined without a newline
+  terminal.startSelection(10.0f + 5 * 11.0f + 1.0f, 4 * 20.0f - 1.0f);
+  terminal.updateSelection(10.0f + 1 * 11.0f + 1.0f, 3 * 20.0f - 1.0f);
+  expect(terminal.getSelectionText() == "56789ab", "selection across wrap");
+  terminal.clearSelection();
+
+  for (int i = 0; i < 50; i++)
+    terminal.processOutput("\r\nline " + std::to_string(i));
+  expect(terminal.getGrid().size() == 10, "bounded at scrollback + rows");
+  expect(lineText(terminal, 9) == "line 49", "newest line kept");
+  expect(terminal.getCursorY() == 9, "cursor follows the dropped lines");
+}
+
+void test_damage() {
+  std::cout << "Starting damage test..." << std::endl;
+  // 10 columns, 4 rows, 6 lines of scrollback
+  Terminal terminal(10 * 11.0f, 4 * 20.0f, 6);
+  Terminal::DamageState state;
+  std::vector<int> rows;
+
+  terminal.collectDamage(state, rows);
+  expect(rows.size() == 4, "first look: everything damaged");
+  terminal.collectDamage(state, rows);
+  expect(rows.empty(), "nothing changed");
+
+  terminal.processOutput("a\r\nb\r\nc");
+  terminal.collectDamage(state, rows);
+  expect(rows == std::vector<int>({0, 1, 2}), "written rows");
+
+  terminal.processOutput("\r\x1b[2A\x1b[K");
+  terminal.collectDamage(state, rows);
+  expect(rows == std::vector<int>({0}), "erased row");
+  terminal.processOutput("\x1b[1;1H\x1b[1C");
+  terminal.collectDamage(state, rows);
+  expect(rows.empty(), "cursor movement alone");
+
+  // Output past the bottom moves every line up a row
+  terminal.processOutput("\x1b[3B\r\nd\r\ne");
+  terminal.collectDamage(state, rows);
+  expect(rows.size() == 4, "scrolled");
+  terminal.scroll(1);
+  terminal.collectDamage(state, rows);
+  expect(rows.size() == 4, "viewport scrolled");
+  terminal.scrollToBottom();
+  terminal.collectDamage(state, rows);
+  terminal.processOutput("f");
+  terminal.collectDamage(state, rows);
+  expect(rows == std::vector<int>({3}), "only the cursor row");
+
+  // Each consumer tracks its own state
+  Terminal::DamageState other;
+  terminal.collectDamage(other, rows);
+  expect(rows.size() == 4, "independent consumers");
+}
+
+int main() {
+  setbuf(stdout, NULL);
+  test_plain_text();
+  test_csi();
+  test_csi_params();
+  test_sgr();
+  test_string_sequences();
+  test_split_sequences();
+  test_ascii_runs();
+  test_autowrap_and_scrollback();
+  test_damage();
+  std::cout << "TEST PASSED" << std::endl;
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include "../src/Terminal.h"
+#include "../src/Utf8Decoder.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void expect(bool condition, const std::string &what) {
+  if (!condition) {
+    std::cout << "TEST FAILED: " << what << std::endl;
+    exit(1);
+  }
+}
+
+std::vector<uint32_t> decode(Utf8Decoder &decoder, const std::string &bytes) {
+  std::vector<uint32_t> out(bytes.size() + 1);
+  size_t count = decoder.decode((const unsigned char *)bytes.data(),
+                                bytes.size(), out.data());
+  out.resize(count);
+  return out;
+}
+
+std::vector<uint32_t> decode(const std::string &bytes) {
+  Utf8Decoder decoder;
+  return decode(decoder, bytes);
+}
+
+void test_valid() {
+  std::cout << "Starting valid UTF-8 test..." << std::endl;
+  // 1, 2, 3 and 4 byte forms, with a long ASCII stretch in between
+  std::string ascii(40, 'x');
+  auto out = decode("a\xc3\xa9" + ascii + "\xe2\x82\xac\xf0\x9f\x98\x80z");
+  std::vector<uint32_t> expected = {'a', 0xE9};
+  expected.insert(expected.end(), ascii.begin(), ascii.end());
+  expected.insert(expected.end(), {0x20AC, 0x1F600, 'z'});
+  expect(out == expected, "valid sequences");
+}
+
+void test_invalid() {
+  std::cout << "Starting invalid UTF-8 test..." << std::endl;
+  const uint32_t R = Utf8Decoder::REPLACEMENT;
+  // Stray continuation, overlong, surrogate, above U+10FFFF
+  expect(decode("a\x80" "b") == std::vector<uint32_t>({'a', R, 'b'}),
+         "stray continuation");
+  expect(decode("\xc0\xaf") == std::vector<uint32_t>({R, R}), "overlong");
+  expect(decode("\xed\xa0\x80") == std::vector<uint32_t>({R, R, R}),
+         "surrogate");
+  expect(decode("\xf4\x90\x80\x80") == std::vector<uint32_t>({R, R, R, R}),
+         "above U+10FFFF");
+  // A truncated sequence is one replacement and doesn't eat the next char
+  expect(decode("\xe2\x82" "a") == std::vector<uint32_t>({R, 'a'}),
+         "truncated sequence");
+}
+
+void test_split_chunks() {
+  std::cout << "Starting split UTF-8 test..." << std::endl;
+  std::string text = "\xf0\x9f\x98\x80 caf\xc3\xa9 \xe2\x82\xac";
+  auto whole = decode(text);
+
+  // Every split point, including inside each multibyte sequence
+  for (size_t cut = 0; cut <= text.size(); cut++) {
+    Utf8Decoder decoder;
+    auto out = decode(decoder, text.substr(0, cut));
+    auto rest = decode(decoder, text.substr(cut));
+    out.insert(out.end(), rest.begin(), rest.end());
+    expect(out == whole, "split at " + std::to_string(cut));
+    expect(!decoder.hasPending(), "nothing pending at end");
+  }
+}
+
+void test_terminal() {
+  std::cout << "Starting terminal UTF-8 test..." << std::endl;
+  std::string stream = "h\xc3\xa9llo \xe2\x9c\x93\r\n\x1b[32m\xf0\x9f\x98\x80"
+                       "\x1b[0m\xe2\x82\r\n";
+  Terminal whole(800.0f, 600.0f);
+  whole.processOutput(stream);
+
+  const auto &lines = whole.getGrid();
+  expect(lines.size() >= 2, "line count");
+  expect(lines[0].size() == 7, "one cell per codepoint");
+  expect(lines[0][1].codepoint == 0xE9, "two byte codepoint");
+  expect(lines[0][6].codepoint == 0x2713, "three byte codepoint");
+  expect(lines[1][0].codepoint == 0x1F600, "four byte codepoint");
+  // Cut short by CR: a single replacement character
+  expect(lines[1].size() == 2 && lines[1][1].codepoint == 0xFFFD,
+         "interrupted sequence");
+
+  Terminal split(800.0f, 600.0f);
+  for (char c : stream)
+    split.processOutput(std::string(1, c));
+  expect(whole.gridHash() == split.gridHash(), "byte-at-a-time hash");
+}
+
+int main() {
+  setbuf(stdout, NULL);
+  test_valid();
+  test_invalid();
+  test_split_chunks();
+  test_terminal();
+  std::cout << "TEST PASSED" << std::endl;
+  return 0;
+}
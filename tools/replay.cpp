@@ -0,0 +1,141 @@
+// Headless replay of a recorded PTY session (see src/SessionRecording.h).
+// Feeds the recorded chunks into Terminal::processOutput without a window
+// and reports parser throughput plus the final grid hash, so parser and grid
+// changes can be measured against the same corpus.
+//
+// Record a session with: TERMINALGL_RECORD=session.rec ./OpenGL
+
+#include "../src/SessionRecording.h"
+#include "../src/Terminal.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static void printUsage(const char *argv0) {
+  std::cout
+      << "Usage: " << argv0 << " <recording> [options]\n"
+      << "  --fast             Feed chunks back to back (default)\n"
+      << "  --realtime         Honour the recorded timestamps\n"
+      << "  --speed <factor>   Play timestamps <factor> times faster\n"
+      << "  --size <cols>x<rows>  Terminal size (default 80x24)\n"
+      << "  --repeat <n>       Replay the corpus n times (fast mode)\n"
+      << "  --scrollback <n>   Lines kept above the screen (default "
+      << Terminal::DEFAULT_SCROLLBACK_LINES << ")\n"
+      << "  --spill <MB>       Keep at most <MB> of compressed history in RAM,\n"
+      << "                     spilling the rest to a temporary file\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::string path;
+  double speed = 0.0; // 0 = as fast as possible
+  int cols = 80;
+  int rows = 24;
+  int repeat = 1;
+  long scrollback = Terminal::DEFAULT_SCROLLBACK_LINES;
+  double spillMB = -1.0; // Off
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--fast") == 0) {
+      speed = 0.0;
+    } else if (strcmp(argv[i], "--realtime") == 0) {
+      speed = 1.0;
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%dx%d", &cols, &rows) != 2) {
+        printUsage(argv[0]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--scrollback") == 0 && i + 1 < argc) {
+      scrollback = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--spill") == 0 && i + 1 < argc) {
+      spillMB = atof(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      printUsage(argv[0]);
+      return 1;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path.empty() || cols < 1 || rows < 1 || repeat < 1 ||
+      scrollback < 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  SessionReplay replay;
+  if (!replay.load(path))
+    return 1;
+
+  const auto &chunks = replay.getChunks();
+  if (speed > 0.0)
+    repeat = 1;
+
+  // Same cell metrics the GUI uses at scale 1.0 (11 x 20 px)
+  Terminal terminal(cols * 11.0f, rows * 20.0f, (size_t)scrollback);
+  if (spillMB >= 0.0 &&
+      !terminal.enableScrollbackSpill((size_t)(spillMB * 1e6)))
+    return 1;
+
+  using Clock = std::chrono::steady_clock;
+  Clock::duration parseTime = Clock::duration::zero();
+  auto wallStart = Clock::now();
+
+  for (int pass = 0; pass < repeat; pass++) {
+    auto passStart = Clock::now();
+    for (const auto &chunk : chunks) {
+      if (speed > 0.0) {
+        auto due = passStart + std::chrono::microseconds((long long)(
+                                   chunk.timestampUs / speed));
+        std::this_thread::sleep_until(due);
+      }
+
+      auto start = Clock::now();
+      terminal.processOutput(chunk.data);
+      parseTime += Clock::now() - start;
+    }
+  }
+
+  double wallSeconds =
+      std::chrono::duration<double>(Clock::now() - wallStart).count();
+  double parseSeconds = std::chrono::duration<double>(parseTime).count();
+  double totalBytes = (double)replay.getTotalBytes() * repeat;
+  double totalChunks = (double)chunks.size() * repeat;
+
+  printf("Recording:   %s\n", path.c_str());
+  printf("Chunks:      %.0f (%.2f MB)\n", totalChunks, totalBytes / 1e6);
+  printf("Wall time:   %.3f s\n", wallSeconds);
+  printf("Parse time:  %.3f s\n", parseSeconds);
+  if (parseSeconds > 0.0) {
+    printf("Throughput:  %.2f MB/s, %.0f chunks/s\n",
+           totalBytes / 1e6 / parseSeconds, totalChunks / parseSeconds);
+  }
+  // Settle the background compressor so the numbers are repeatable
+  const Grid &grid = terminal.getGrid();
+  grid.waitForCompression();
+  Grid::MemoryStats memory = grid.getMemoryStats();
+  printf("Grid memory: %.2f MB (%zu lines)\n", memory.total() / 1e6,
+         grid.size());
+  printf("  ring:      %.2f MB\n", memory.ringBytes / 1e6);
+  printf("  history:   %.2f MB compressed (%zu lines, %zu pages)\n",
+         memory.scrollback.compressedBytes / 1e6, memory.scrollback.lines,
+         memory.scrollback.pages);
+  if (spillMB >= 0.0) {
+    printf("  spilled:   %.2f MB on disk (%zu pages)\n",
+           memory.scrollback.spilledBytes / 1e6,
+           memory.scrollback.spilledPages);
+  }
+  printf("Grid hash:   %016llx\n", (unsigned long long)terminal.gridHash());
+  return 0;
+}